@@ -0,0 +1,125 @@
+#include "Agc.h"
+
+#include <math.h>
+
+#define FRACTION_BITS 8
+#define INPUT_MAX ((1L << 22) - 1)
+#define ONE 65536
+
+/** The share of the distance an envelope closes per update, of ONE. */
+static uint32_t coefficient(uint32_t updateMicros, uint16_t ms) {
+  if (ms == 0)
+    return ONE;
+  float share = 1 - expf(-(updateMicros / 1000.0f) / ms);
+  return constrain(lroundf(share * ONE), 1, ONE);
+}
+
+static inline void follow(int32_t& envelope, int32_t target, uint32_t k) {
+  envelope += static_cast<int32_t>(
+      (static_cast<int64_t>(target - envelope) * k) >> 16);
+}
+
+void Agc::Controller::begin(uint8_t n, float inputScale, const Settings& s) {
+  count = min(n, static_cast<uint8_t>(AGC_MAX_BANDS));
+  scale = inputScale;
+  settings = s;
+  // Coefficients again for the new settings.
+  for (uint8_t i = 0; i < AGC_INTERVALS; i++) {
+    intervals[i].interval = UINT32_MAX;
+  }
+  current = intervals;
+
+  kneeStart = constrain(settings.kneePercent, 50, 100) * ONE / 100;
+  uint32_t span = (settings.minSpan < INPUT_MAX) ? settings.minSpan : INPUT_MAX;
+  minSpan = ((span > 0) ? span : 1) << FRACTION_BITS;
+  reset();
+}
+
+void Agc::Controller::reset() {
+  primed = false;
+}
+
+void Agc::Controller::setInterval(uint32_t micros) {
+  if (current->interval == micros)
+    return;
+  for (uint8_t i = 0; i < AGC_INTERVALS; i++) {
+    if (intervals[i].interval == micros) {
+      current = &intervals[i];
+      return;
+    }
+  }
+
+  // Takes the place of the one worked out longest ago.
+  Coefficients& c = intervals[nextInterval];
+  nextInterval = (nextInterval + 1) % AGC_INTERVALS;
+  c.interval = micros;
+  c.attack = coefficient(micros, settings.attackMs);
+  c.release = coefficient(micros, settings.releaseMs);
+  c.peakRelease = coefficient(micros, settings.peakReleaseMs);
+  c.floorFall = coefficient(micros, settings.floorFallMs);
+  c.floorRise = coefficient(micros, settings.floorRiseMs);
+  current = &c;
+}
+
+void Agc::Controller::update(const float* levels,
+                             uint8_t* out,
+                             uint32_t elapsedMicros) {
+  setInterval(elapsedMicros);
+  const Coefficients& k = *current;
+
+  for (uint8_t b = 0; b < count; b++) {
+    Band& band = bands[b];
+    float scaled = levels[b] * scale;
+    int32_t x = (scaled <= 0)          ? 0
+                : (scaled < INPUT_MAX) ? static_cast<int32_t>(scaled)
+                                       : INPUT_MAX;
+    x <<= FRACTION_BITS;
+
+    // The first level is taken as the noise floor.
+    if (!primed)
+      band = {x, x, x};
+
+    follow(band.level, x, (x > band.level) ? k.attack : k.release);
+    follow(band.floor, band.level,
+           (band.level < band.floor) ? k.floorFall : k.floorRise);
+    follow(band.peak, band.level,
+           (band.level > band.peak) ? k.attack : k.peakRelease);
+
+    out[b] = normalize(band);
+  }
+  primed = true;
+}
+
+/**
+ * Where the level sits between floor and peak, of ONE, through the knee.
+ * Both are shifted down until the span fits 15 bits, so the division stays
+ * 32 bit.
+ */
+uint8_t Agc::Controller::normalize(const Band& band) {
+  int32_t above = band.level - band.floor - (band.floor >> 3);
+  if (above <= 0)
+    return 0;
+
+  int32_t least = (band.floor > minSpan) ? band.floor : minSpan;
+  int32_t range = band.peak - band.floor;
+  uint32_t span = (range > least) ? range : least;
+  uint8_t bits = 32 - __builtin_clz(span);
+  uint8_t shift = (bits > 15) ? bits - 15 : 0;
+  span >>= shift;
+  uint32_t d = min(static_cast<uint32_t>(above) >> shift, 2 * span - 1);
+  uint32_t n = (d << 16) / span;
+
+  // Soft knee: linear up to kneeStart, full scale at 2 - kneeStart.
+  uint32_t y = n;
+  if (n > kneeStart) {
+    uint32_t width = ONE - kneeStart;
+    uint32_t past = n - kneeStart;
+    if (width == 0 || past >= 2 * width) {
+      y = ONE;
+    } else {
+      uint32_t bend = (past << 14) / width;
+      y = n - ((past * bend) >> 16);
+    }
+  }
+  return min((y * 255 + ONE / 2) >> 16, static_cast<uint32_t>(255));
+}
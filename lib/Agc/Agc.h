@@ -0,0 +1,97 @@
+/**
+ * Automatic gain for spectrum bands, in fixed point.
+ *
+ * Every band keeps three envelopes of its level:
+ *  - the level itself, rising with attack and falling with release, is what
+ *    gets shown,
+ *  - the noise floor drops quickly to quiet stretches and creeps up slowly,
+ *  - the peak jumps up with the level and decays over seconds.
+ * The level between floor and peak is scaled to 0 - 255 through a soft
+ * knee: linear up to kneePercent, then bending smoothly into full scale a
+ * little above the peak instead of clipping at it. A level shows once it
+ * is an eighth above the floor, and the span from floor to peak never drops
+ * below minSpan or the floor itself, so steady noise stays dark however
+ * loud it is.
+ *
+ * Envelopes are 32 bit with 8 fraction bits and the coefficients 16 bit
+ * fractions. Every update is given the time since the one before, so the
+ * envelopes keep their times however often the levels are read. The
+ * coefficients of the last AGC_INTERVALS intervals are kept, so updates
+ * alternating between one and two hops do not work them out every time.
+ */
+#ifndef AGC_H
+#define AGC_H
+
+#include <Arduino.h>
+
+#define AGC_MAX_BANDS 64
+#define AGC_INTERVALS 4
+
+namespace Agc {
+
+typedef struct Settings {
+  uint16_t attackMs;
+  uint16_t releaseMs;
+  uint16_t peakReleaseMs;
+  uint16_t floorFallMs;
+  uint16_t floorRiseMs;
+  uint8_t kneePercent;  // 50 - 100, 100 clips hard
+  uint32_t minSpan;  // in input units after scaling
+} Settings;
+
+const Settings DEFAULTS = {10, 150, 3000, 400, 8000, 75, 1024};
+
+typedef struct Band {
+  int32_t level;
+  int32_t floor;
+  int32_t peak;
+} Band;
+
+/** Envelope coefficients for updates interval us apart. */
+typedef struct Coefficients {
+  uint32_t interval;
+  uint32_t attack;
+  uint32_t release;
+  uint32_t peakRelease;
+  uint32_t floorFall;
+  uint32_t floorRise;
+} Coefficients;
+
+class Controller {
+ private:
+  Band bands[AGC_MAX_BANDS];
+  uint8_t count = 0;
+  float scale = 1;
+  Settings settings = DEFAULTS;
+  Coefficients intervals[AGC_INTERVALS] = {};
+  uint8_t nextInterval = 0;
+  const Coefficients* current = intervals;
+  uint32_t kneeStart = 0;
+  int32_t minSpan = 0;
+  bool primed = false;
+
+  void setInterval(uint32_t micros);
+  uint8_t normalize(const Band& band);
+
+ public:
+  /**
+   * Set up for n bands. Levels are multiplied by inputScale and then taken
+   * as whole numbers, up to 2^22.
+   */
+  void begin(uint8_t n, float inputScale = 1, const Settings& s = DEFAULTS);
+
+  /** Forgets the envelopes, the next levels are taken as the floor. */
+  void reset();
+
+  /**
+   * Takes the newest level of every band, elapsedMicros after the previous
+   * ones, and writes them scaled to out.
+   */
+  void update(const float* levels, uint8_t* out, uint32_t elapsedMicros);
+
+  const Band& getBand(uint8_t band) const { return bands[band]; }
+};
+
+}  // namespace Agc
+
+#endif  // AGC_H
@@ -0,0 +1,134 @@
+#include "AudioCapture.h"
+
+#include <Clock.h>
+
+#ifdef ESP32
+#include <driver/adc.h>
+#include <driver/i2s.h>
+#endif
+
+static const uint32_t RING_MASK = CAPTURE_RING_SIZE - 1;
+// Oldest a read may reach back, a write in progress stores up to a DMA
+// buffer past the written index before it is published.
+static const uint32_t RING_KEPT = CAPTURE_RING_SIZE - CAPTURE_DMA_LENGTH;
+
+// ========================================================================
+// Ring
+// ========================================================================
+void AudioCapture::Ring::write(const uint16_t* data, uint16_t n) {
+  uint32_t at = written.load(std::memory_order_relaxed);
+  for (uint16_t i = 0; i < n; i++) {
+    samples[(at + i) & RING_MASK] = data[i];
+  }
+  written.store(at + n, std::memory_order_release);
+}
+
+void AudioCapture::Ring::write(uint16_t sample) {
+  uint32_t at = written.load(std::memory_order_relaxed);
+  samples[at & RING_MASK] = sample;
+  written.store(at + 1, std::memory_order_release);
+}
+
+bool AudioCapture::Ring::read(uint32_t end, uint16_t* out, uint16_t n) {
+  uint32_t newest = getWritten();
+  uint32_t start = end - n;
+  if (n > RING_KEPT || end > newest || end < n || newest - start > RING_KEPT)
+    return false;
+
+  uint16_t first = start & RING_MASK;
+  uint16_t run =
+      (n < CAPTURE_RING_SIZE - first) ? n : CAPTURE_RING_SIZE - first;
+  memcpy(out, samples + first, run * sizeof(uint16_t));
+  memcpy(out + run, samples, (n - run) * sizeof(uint16_t));
+
+  // The writer may have wrapped around onto what was just copied.
+  std::atomic_thread_fence(std::memory_order_acquire);
+  return written.load(std::memory_order_relaxed) - start <= RING_KEPT;
+}
+
+bool AudioCapture::Ring::latest(uint16_t* out, uint16_t n) {
+  return read(getWritten(), out, n);
+}
+
+// ========================================================================
+// Capture
+// ========================================================================
+bool AudioCapture::Capture::begin(uint8_t p, uint32_t r) {
+  pin = p;
+  rate = r;
+
+#ifdef ESP32
+  i2s_config_t config = {};
+  config.mode = static_cast<i2s_mode_t>(I2S_MODE_MASTER | I2S_MODE_RX |
+                                        I2S_MODE_ADC_BUILT_IN);
+  config.sample_rate = rate;
+  config.bits_per_sample = I2S_BITS_PER_SAMPLE_16BIT;
+  config.channel_format = I2S_CHANNEL_FMT_ONLY_LEFT;
+  config.communication_format = I2S_COMM_FORMAT_I2S_MSB;
+  config.dma_buf_count = CAPTURE_DMA_BUFFERS;
+  config.dma_buf_len = CAPTURE_DMA_LENGTH;
+
+  adc1_channel_t channel =
+      static_cast<adc1_channel_t>(digitalPinToAnalogChannel(pin));
+  adc1_config_width(ADC_WIDTH_BIT_12);
+  adc1_config_channel_atten(channel, ADC_ATTEN_DB_11);
+
+  if (i2s_driver_install(I2S_NUM_0, &config, 0, nullptr) != ESP_OK ||
+      i2s_set_adc_mode(ADC_UNIT_1, channel) != ESP_OK ||
+      i2s_adc_enable(I2S_NUM_0) != ESP_OK) {
+#ifdef DEBUG
+    Serial.println("[capture] could not start i2s adc.");
+#endif
+    return false;
+  }
+
+  xTaskCreatePinnedToCore(captureTask, "capture", CAPTURE_TASK_STACK, this,
+                          CAPTURE_TASK_PRIORITY, &task, CAPTURE_TASK_CORE);
+#else
+  startMicros = Clock::micros();
+  produced = 0;
+#endif
+
+#ifdef DEBUG
+  Serial.printf("[capture] sampling pin %i at %u Hz.\n", pin, rate);
+#endif
+  return true;
+}
+
+void AudioCapture::Capture::update() {
+#ifndef ESP32
+  uint32_t due = static_cast<uint64_t>(Clock::micros() - startMicros) * rate /
+                 1000000;
+
+  // After a long gap only the newest ring full matters.
+  if (due - produced > CAPTURE_RING_SIZE)
+    produced = due - CAPTURE_RING_SIZE;
+
+  while (produced != due) {
+    ring.write(analogRead(pin));
+    produced++;
+  }
+#endif
+}
+
+#ifdef ESP32
+/**
+ * Waits for each DMA buffer and moves it into the ring. The ADC puts the
+ * channel in the top 4 bits of every sample.
+ */
+void AudioCapture::Capture::captureTask(void* self) {
+  Capture* capture = static_cast<Capture*>(self);
+  static uint16_t buffer[CAPTURE_DMA_LENGTH];
+
+  for (;;) {
+    size_t bytes = 0;
+    i2s_read(I2S_NUM_0, buffer, sizeof(buffer), &bytes, portMAX_DELAY);
+
+    uint16_t n = bytes / sizeof(uint16_t);
+    for (uint16_t i = 0; i < n; i++) {
+      buffer[i] &= 0x0fff;
+    }
+    capture->ring.write(buffer, n);
+  }
+}
+#endif
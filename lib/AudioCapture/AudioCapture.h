@@ -0,0 +1,92 @@
+/**
+ * Continuous audio capture into a ring buffer.
+ *
+ * On ESP32 the built in ADC is sampled through I2S with DMA at the given
+ * rate, and a task on core 0 moves every DMA buffer into the ring as it
+ * fills, so the render loop never waits for samples. Readers copy out the
+ * most recent window whenever they want one.
+ *
+ * The native build has no ADC task. update() writes as many samples as the
+ * time passed on Clock calls for, read through analogRead(), so a synthetic
+ * source set with setAnalogReadSource() feeds the same ring.
+ *
+ * The ring has one writer and any number of readers. A read copies first and
+ * then checks the writer did not lap the copied part in the meantime.
+ */
+#ifndef AUDIOCAPTURE_H
+#define AUDIOCAPTURE_H
+
+#include <Arduino.h>
+
+#include <atomic>
+
+#ifdef ESP32
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#endif
+
+// Samples kept, a power of two.
+#define CAPTURE_RING_SIZE 4096
+// Samples in a DMA buffer, the most the writer moves into the ring at once.
+#define CAPTURE_DMA_LENGTH 256
+
+#ifdef ESP32
+#define CAPTURE_DMA_BUFFERS 4
+#define CAPTURE_TASK_CORE 0
+#define CAPTURE_TASK_PRIORITY 3
+#define CAPTURE_TASK_STACK 3072
+#endif
+
+namespace AudioCapture {
+
+class Ring {
+ private:
+  uint16_t samples[CAPTURE_RING_SIZE] = {};
+  std::atomic<uint32_t> written{0};
+
+ public:
+  void write(const uint16_t* data, uint16_t n);
+  void write(uint16_t sample);
+
+  /** Samples written since start, the index one past the newest. */
+  uint32_t getWritten() { return written.load(std::memory_order_acquire); }
+
+  /**
+   * Copies the n samples before index end, oldest first. Returns false when
+   * they have not all been written yet, were overwritten or are within a
+   * DMA buffer of being overwritten by a write still in progress.
+   */
+  bool read(uint32_t end, uint16_t* out, uint16_t n);
+
+  /** The newest n samples. */
+  bool latest(uint16_t* out, uint16_t n);
+};
+
+class Capture {
+ private:
+  Ring ring;
+  uint8_t pin = 0;
+  uint32_t rate = 0;
+#ifdef ESP32
+  TaskHandle_t task = nullptr;
+
+  static void captureTask(void* self);
+#else
+  uint32_t startMicros = 0;
+  uint32_t produced = 0;
+#endif
+
+ public:
+  /** Starts sampling pin at rate Hz. */
+  bool begin(uint8_t pin, uint32_t rate);
+
+  /** Brings the ring up to date where there is no capture task. */
+  void update();
+
+  Ring& getRing() { return ring; }
+  uint32_t getRate() { return rate; }
+};
+
+}  // namespace AudioCapture
+
+#endif  // AUDIOCAPTURE_H
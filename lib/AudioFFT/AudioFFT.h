@@ -1,15 +1,30 @@
 #ifndef AUDIOFFT_H
 #define AUDIOFFT_H
 
+#include <Agc.h>
 #include <Arduino.h>
 #include <Audio.h>
+#include <Bands.h>
+#include <Clock.h>
 #include <FastLED.h>
 
 #include <array>
-#include <list>
 
 #define FFT_SAMPLES 1024
+#ifndef FFT_BUCKETS
 #define FFT_BUCKETS 6
+#endif
+#ifndef FFT_BAND_SPACING
+#define FFT_BAND_SPACING Bands::defaultSpacing(FFT_BUCKETS)
+#endif
+// A new spectrum every 512 samples.
+#define FFT_UPDATE_MICROS 11610
+// Bin magnitudes go from 0 to 1, the levels are scaled by FFT_SCALE.
+#define FFT_SCALE 65536
+// Smallest rise over the noise floor that reaches full scale, 0.02.
+#ifndef FFT_MIN_SPAN
+#define FFT_MIN_SPAN 1311
+#endif
 
 // GUItool: begin automatically generated code
 AudioOutputI2S myi2s;
@@ -29,69 +44,50 @@ class AudioFFT {
   void setup() {
     AudioMemory(12);
     afft.windowFunction(AudioWindowHanning1024);
+    bands.build(FFT_BAND_SPACING, FFT_BUCKETS, AUDIO_SAMPLE_RATE_EXACT,
+                FFT_SAMPLES);
+
+    Agc::Settings settings = Agc::DEFAULTS;
+    settings.minSpan = FFT_MIN_SPAN;
+    agc.begin(FFT_BUCKETS, FFT_SCALE, settings);
   }
 
+  /**
+   * Buckets of the newest spectrum, levelled when a new one is ready. The
+   * gain control is given the whole spectra since the last one taken, so
+   * spectra nobody read still count for its times.
+   */
   std::array<uint8_t, FFT_BUCKETS> getSampleSet() {
-    // fftComputeSampleset();
-    fillBuckets();
-
-    EVERY_N_MILLIS(20) { calcMaxValues(); }
-
-    calcVuBuckets();
+    if (afft.available()) {
+      uint32_t now = Clock::micros();
+      uint32_t spectra =
+          (now - lastUpdate + FFT_UPDATE_MICROS / 2) / FFT_UPDATE_MICROS;
+      lastUpdate = now;
+
+      fillBuckets();
+      agc.update(f_buckets.data(), vu_buckets.data(),
+                 (spectra ? spectra : 1) * FFT_UPDATE_MICROS);
+    }
 
     return vu_buckets;
   }
 
+  /** Buckets last returned by getSampleSet(), without taking a new one. */
+  const std::array<uint8_t, FFT_BUCKETS>& getBuckets() { return vu_buckets; }
+
  private:
   std::array<float, FFT_BUCKETS> f_buckets;
-  std::array<uint8_t, FFT_BUCKETS> vu_buckets;
-  std::list<float> max_values[6];
+  std::array<uint8_t, FFT_BUCKETS> vu_buckets = {};
+  float magnitudes[FFT_SAMPLES / 2 + 1] = {};
+  Bands::Mapper bands;
+  Agc::Controller agc;
+  uint32_t lastUpdate = 0;
 
   void fillBuckets() {
-    // Bass: 0 - 250 Hz
-    f_buckets[0] = afft.read(2, 6);
-    // Low Midrange: 250 - 500 Hz
-    f_buckets[1] = afft.read(7, 12);
-    // Midrange: 500 - 2000 Hz
-    f_buckets[2] = afft.read(13, 47);
-    // Midrange: 2000 - 4000 Hz
-    f_buckets[3] = afft.read(48, 93);
-    // Presence: 4000 - 6000 Hz
-    f_buckets[4] = afft.read(94, 140);
-    // Brilliance: 6000 - 20000 Hz
-    f_buckets[5] = afft.read(140, 384);
-  }
-
-  void calcMaxValues() {
-    for (uint8_t j = 0; j < 6; j++) {
-      max_values[j].push_back(f_buckets[j]);
-
-      if (max_values[j].size() > 2048) {
-        max_values[j].pop_front();
-      }
-    }
-  }
-
-  void calcVuBuckets() {
-    float all_max = 0.000001;
-
-    for (uint8_t i = 0; i < FFT_BUCKETS; i++) {
-      float inner_max = 0.000001;
-
-      for (float v : max_values[i]) {
-        inner_max = (v > inner_max) ? v : inner_max;
-      }
-
-      all_max = (inner_max > all_max) ? inner_max : all_max;
-
-      if (f_buckets[i] > 0.05 && inner_max / all_max > 0.25) {
-        float normalize = f_buckets[i] / (inner_max * 0.9);
-        normalize = (normalize > 1.0) ? 1.0 : normalize;
-        vu_buckets[i] = (uint8_t)255 * normalize;
-      } else {
-        vu_buckets[i] = 0;
-      }
+    for (uint16_t i = 0; i < FFT_SAMPLES / 2; i++) {
+      magnitudes[i] = afft.read(i);
     }
+    bands.map(magnitudes, f_buckets.data());
   }
 };
 #endif  // AUDIOFFT_H
\ No newline at end of file
@@ -0,0 +1,150 @@
+#include "Bands.h"
+
+#include <math.h>
+
+static float toMel(float hz) { return 2595 * log10f(1 + hz / 700); }
+
+static float fromMel(float mel) { return 700 * (powf(10, mel / 2595) - 1); }
+
+bool Bands::Mapper::fail(const char* reason) {
+#ifdef DEBUG
+  Serial.printf("[bands] %s.\n", reason);
+#endif
+  count = 0;
+  used = 0;
+  return false;
+}
+
+bool Bands::Mapper::begin(uint8_t n, float sampleRate, uint16_t fftSize) {
+  count = 0;
+  used = 0;
+  binHz = sampleRate / fftSize;
+  lastBin = fftSize / 2;
+  return n >= BANDS_MIN && n <= BANDS_MAX;
+}
+
+bool Bands::Mapper::build(Spacing spacing,
+                          uint8_t n,
+                          float sampleRate,
+                          uint16_t fftSize,
+                          float lowHz,
+                          float highHz) {
+  if (spacing == Spacing::Named) {
+    if (n != NAMED_COUNT)
+      return fail("named bands come as six");
+    return buildCustom(NAMED_EDGES, n, sampleRate, fftSize);
+  }
+
+  if (!begin(n, sampleRate, fftSize) || lowHz <= 0 || highHz <= lowHz)
+    return fail("no such bands");
+  if (highHz > sampleRate / 2)
+    highHz = sampleRate / 2;
+
+  // n + 2 points, every band spans three of them.
+  float points[BANDS_MAX + 2];
+  float low = (spacing == Spacing::Mel) ? toMel(lowHz) : log2f(lowHz);
+  float high = (spacing == Spacing::Mel) ? toMel(highHz) : log2f(highHz);
+  for (uint8_t i = 0; i < n + 2; i++) {
+    float at = low + (high - low) * i / (n + 1);
+    points[i] = (spacing == Spacing::Mel) ? fromMel(at) : exp2f(at);
+  }
+
+  for (uint8_t b = 0; b < n; b++) {
+    if (!addTriangle(points[b], points[b + 1], points[b + 2]))
+      return fail("weight table full");
+  }
+  return true;
+}
+
+bool Bands::Mapper::buildCustom(const float* edges,
+                                uint8_t n,
+                                float sampleRate,
+                                uint16_t fftSize) {
+  if (!begin(n, sampleRate, fftSize))
+    return fail("no such bands");
+
+  for (uint8_t b = 0; b < n; b++) {
+    if (edges[b + 1] <= edges[b])
+      return fail("edges must ascend");
+    if (!addRange(edges[b], edges[b + 1]))
+      return fail("weight table full");
+  }
+  return true;
+}
+
+bool Bands::Mapper::addTriangle(float low, float center, float high) {
+  uint16_t first = max(1, static_cast<int>(ceilf(low / binHz)));
+  uint16_t last = min(static_cast<int>(lastBin),
+                      static_cast<int>(floorf(high / binHz)));
+
+  // Trim the zero weights at the ends.
+  while (first <= last && first * binHz <= low)
+    first++;
+  while (last >= first && last * binHz >= high)
+    last--;
+  if (first > last)
+    return addBin(lroundf(center / binHz), center);
+  if (used + last - first + 1 > BANDS_MAX_WEIGHTS)
+    return false;
+
+  float* w = weights + used;
+  float sum = 0;
+  for (uint16_t bin = first; bin <= last; bin++) {
+    float hz = bin * binHz;
+    float weight = (hz <= center) ? (hz - low) / (center - low)
+                                  : (high - hz) / (high - center);
+    w[bin - first] = weight;
+    sum += weight;
+  }
+  for (uint16_t i = 0; i <= last - first; i++) {
+    w[i] /= sum;
+  }
+
+  bands[count++] = {first, static_cast<uint16_t>(last - first + 1), center};
+  used += last - first + 1;
+  return true;
+}
+
+bool Bands::Mapper::addRange(float low, float high) {
+  uint16_t first = max(1, static_cast<int>(ceilf(low / binHz)));
+  uint16_t last = static_cast<uint16_t>(ceilf(high / binHz)) - 1;
+  if (last > lastBin)
+    last = lastBin;
+
+  float center = sqrtf(low * high);
+  if (first > last)
+    return addBin(lroundf(center / binHz), center);
+  if (used + last - first + 1 > BANDS_MAX_WEIGHTS)
+    return false;
+
+  uint16_t bins = last - first + 1;
+  for (uint16_t i = 0; i < bins; i++) {
+    weights[used + i] = 1.0f / bins;
+  }
+  bands[count++] = {first, bins, center};
+  used += bins;
+  return true;
+}
+
+bool Bands::Mapper::addBin(uint16_t bin, float center) {
+  if (used >= BANDS_MAX_WEIGHTS)
+    return false;
+
+  bin = constrain(bin, 1, lastBin);
+  weights[used++] = 1;
+  bands[count++] = {bin, 1, center};
+  return true;
+}
+
+void Bands::Mapper::map(const float* magnitudes, float* out) const {
+  const float* w = weights;
+  for (uint8_t b = 0; b < count; b++) {
+    const float* m = magnitudes + bands[b].first;
+    float power = 0;
+    for (uint16_t i = 0; i < bands[b].bins; i++) {
+      power += m[i] * m[i] * w[i];
+    }
+    out[b] = sqrtf(power);
+    w += bands[b].bins;
+  }
+}
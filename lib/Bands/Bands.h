@@ -0,0 +1,94 @@
+/**
+ * Maps FFT magnitudes onto frequency bands.
+ *
+ * Every band is a run of consecutive bins with a weight each, and the
+ * weights of all bands sit back to back in one table, built once for a
+ * sample rate and FFT size. map() then walks the table in a single pass.
+ *
+ * Log and Mel spacing give overlapping triangular bands, each peaking at its
+ * centre and reaching to the centres of its neighbours. Custom edges give
+ * bands that end where the next one starts, Named are the six classic ones:
+ * bass, low midrange, midrange, upper midrange, presence and brilliance.
+ * The weights of a band add up to one and a band reads as the weighted RMS
+ * of its bins: a tone in a wide band is not averaged away, and neither does
+ * a wide band add up its noise. A band narrower than a bin gets the closest
+ * bin.
+ */
+#ifndef BANDS_H
+#define BANDS_H
+
+#include <Arduino.h>
+
+#define BANDS_MIN 6
+#define BANDS_MAX 64
+
+// Range spread over by Log and Mel spacing.
+#define BANDS_LOW_HZ 40
+#define BANDS_HIGH_HZ 16000
+
+// Overlapping bands use each bin at most twice, plus a bin for narrow ones.
+#define BANDS_MAX_WEIGHTS (1024 + BANDS_MAX)
+
+namespace Bands {
+
+typedef enum { Log, Mel, Named } Spacing;
+
+// Edges of the Named bands in Hz.
+const float NAMED_EDGES[] = {60, 250, 500, 2000, 4000, 6000, 20000};
+const uint8_t NAMED_COUNT = sizeof(NAMED_EDGES) / sizeof(NAMED_EDGES[0]) - 1;
+
+/** Named for six bands, Log for any other count. */
+inline Spacing defaultSpacing(uint8_t n) {
+  return (n == NAMED_COUNT) ? Spacing::Named : Spacing::Log;
+}
+
+typedef struct Band {
+  uint16_t first;  // first bin
+  uint16_t bins;
+  float center;  // Hz
+} Band;
+
+class Mapper {
+ private:
+  Band bands[BANDS_MAX];
+  float weights[BANDS_MAX_WEIGHTS];
+  uint16_t used = 0;
+  uint8_t count = 0;
+  float binHz = 0;
+  uint16_t lastBin = 0;
+
+  bool begin(uint8_t n, float sampleRate, uint16_t fftSize);
+  bool addTriangle(float low, float center, float high);
+  bool addRange(float low, float high);
+  bool addBin(uint16_t bin, float center);
+  bool fail(const char* reason);
+
+ public:
+  /**
+   * Builds n bands of the given spacing for an FFT of fftSize samples at
+   * sampleRate. Named only comes with NAMED_COUNT bands.
+   */
+  bool build(Spacing spacing,
+             uint8_t n,
+             float sampleRate,
+             uint16_t fftSize,
+             float lowHz = BANDS_LOW_HZ,
+             float highHz = BANDS_HIGH_HZ);
+
+  /** Builds n bands between the n + 1 ascending edges in Hz. */
+  bool buildCustom(const float* edges,
+                   uint8_t n,
+                   float sampleRate,
+                   uint16_t fftSize);
+
+  /** Writes the level of every band to out, from fftSize / 2 + 1 bins. */
+  void map(const float* magnitudes, float* out) const;
+
+  uint8_t getCount() const { return count; }
+  const Band& getBand(uint8_t band) const { return bands[band]; }
+  uint16_t getWeightCount() const { return used; }
+};
+
+}  // namespace Bands
+
+#endif  // BANDS_H
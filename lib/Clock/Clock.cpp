@@ -0,0 +1,43 @@
+#include "Clock.h"
+
+static bool virtualTime = false;
+static uint64_t virtualMicros = 0;
+
+void Clock::useRealtime() {
+  virtualTime = false;
+}
+
+void Clock::useVirtual(uint32_t startMillis) {
+  virtualTime = true;
+  virtualMicros = static_cast<uint64_t>(startMillis) * 1000;
+}
+
+bool Clock::isVirtual() {
+  return virtualTime;
+}
+
+void Clock::advanceMillis(uint32_t ms) {
+  virtualMicros += static_cast<uint64_t>(ms) * 1000;
+}
+
+void Clock::advanceMicros(uint32_t us) {
+  virtualMicros += us;
+}
+
+uint32_t Clock::millis() {
+  if (virtualTime)
+    return static_cast<uint32_t>(virtualMicros / 1000);
+  return ::millis();
+}
+
+uint32_t Clock::micros() {
+  if (virtualTime)
+    return static_cast<uint32_t>(virtualMicros);
+  return ::micros();
+}
+
+#ifdef USE_GET_MILLISECOND_TIMER
+uint32_t get_millisecond_timer() {
+  return Clock::millis();
+}
+#endif
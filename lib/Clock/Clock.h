@@ -0,0 +1,34 @@
+/**
+ * Time source for effects, commands and audio.
+ *
+ * Defaults to the Arduino millis()/micros(). A virtual clock can be switched
+ * in that only moves when advanced, which makes frames reproducible and lets
+ * the native build run animations faster than real time.
+ *
+ * FastLED's EVERY_N_* timers and beat functions read this clock through
+ * get_millisecond_timer() when built with USE_GET_MILLISECOND_TIMER.
+ */
+#ifndef CLOCK_H
+#define CLOCK_H
+
+#include <Arduino.h>
+
+namespace Clock {
+
+void useRealtime();
+void useVirtual(uint32_t startMillis = 0);
+bool isVirtual();
+
+void advanceMillis(uint32_t ms);
+void advanceMicros(uint32_t us);
+
+uint32_t millis();
+uint32_t micros();
+
+}  // namespace Clock
+
+#ifdef USE_GET_MILLISECOND_TIMER
+uint32_t get_millisecond_timer();
+#endif
+
+#endif  // CLOCK_H
@@ -0,0 +1,32 @@
+#include "Animation.hpp"
+
+uint32_t Animation::ease(Easing easing, uint32_t t) {
+  uint32_t inverse = PROGRESS_END - t;
+
+  switch (easing) {
+    case Easing::EaseIn:
+      return (static_cast<uint64_t>(t) * t) >> 16;
+    case Easing::EaseOut:
+      return PROGRESS_END - ((static_cast<uint64_t>(inverse) * inverse) >> 16);
+    case Easing::EaseInOut:
+      // Smoothstep, t * t * (3 - 2t).
+      return (static_cast<uint64_t>(t) * t * (3 * PROGRESS_END - 2 * t)) >> 32;
+    default:
+      return t;
+  }
+}
+
+void Animation::begin(Tween& tween, uint32_t duration, Easing easing) {
+  tween.start = Clock::millis();
+  tween.duration = duration;
+  tween.easing = easing;
+}
+
+uint32_t Animation::progress(const Tween& tween, uint32_t now) {
+  uint32_t elapsed = now - tween.start;
+  if (elapsed >= tween.duration)
+    return PROGRESS_END;
+
+  uint32_t t = (static_cast<uint64_t>(elapsed) << 16) / tween.duration;
+  return ease(tween.easing, t);
+}
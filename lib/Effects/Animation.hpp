@@ -0,0 +1,44 @@
+/**
+ * Time based transitions.
+ *
+ * A Tween maps the time since it started onto an eased progress from 0 to
+ * PROGRESS_END in fixed point. It is driven by the clock rather than by
+ * counting frames, so a transition takes its duration whatever the frame
+ * rate or loop jitter, and the last frame lands exactly on the end value.
+ */
+#ifndef Animation_h
+#define Animation_h
+
+#include <Arduino.h>
+
+#include <Clock.h>
+
+namespace Animation {
+
+typedef enum { Linear, EaseIn, EaseOut, EaseInOut } Easing;
+
+/** Progress is 16.16 fixed point, PROGRESS_END is all the way. */
+const uint32_t PROGRESS_END = 0x10000;
+
+typedef struct Tween {
+  uint32_t start;
+  uint32_t duration;
+  Easing easing;
+} Tween;
+
+/** Eases linear progress t (0-PROGRESS_END). */
+uint32_t ease(Easing easing, uint32_t t);
+
+void begin(Tween& tween, uint32_t duration, Easing easing);
+
+/** Eased progress at now (ms), PROGRESS_END once the duration has passed. */
+uint32_t progress(const Tween& tween, uint32_t now);
+
+inline int32_t lerp(int32_t from, int32_t to, uint32_t progress) {
+  return from + static_cast<int32_t>(
+                    (static_cast<int64_t>(to - from) * progress) >> 16);
+}
+
+}  // namespace Animation
+
+#endif  // Animation_h
@@ -0,0 +1,72 @@
+#include "ColorTemperature.hpp"
+
+// Generated by native/bench/colortemp with --table.
+const uint8_t ColorTemperature::table[TABLE_SIZE][3] = {
+    {255, 255, 251},  // 153 mired
+    {255, 250, 243},  // 161 mired
+    {255, 245, 235},  // 169 mired
+    {255, 240, 227},  // 177 mired
+    {255, 236, 219},  // 185 mired
+    {255, 232, 212},  // 193 mired
+    {255, 228, 205},  // 201 mired
+    {255, 224, 198},  // 209 mired
+    {255, 220, 192},  // 217 mired
+    {255, 216, 185},  // 225 mired
+    {255, 213, 179},  // 233 mired
+    {255, 209, 173},  // 241 mired
+    {255, 206, 167},  // 249 mired
+    {255, 203, 161},  // 257 mired
+    {255, 200, 155},  // 265 mired
+    {255, 197, 150},  // 273 mired
+    {255, 194, 144},  // 281 mired
+    {255, 191, 139},  // 289 mired
+    {255, 189, 133},  // 297 mired
+    {255, 186, 128},  // 305 mired
+    {255, 183, 123},  // 313 mired
+    {255, 181, 118},  // 321 mired
+    {255, 179, 113},  // 329 mired
+    {255, 176, 108},  // 337 mired
+    {255, 174, 103},  // 345 mired
+    {255, 171,  98},  // 353 mired
+    {255, 169,  93},  // 361 mired
+    {255, 167,  88},  // 369 mired
+    {255, 165,  83},  // 377 mired
+    {255, 163,  79},  // 385 mired
+    {255, 161,  74},  // 393 mired
+    {255, 159,  69},  // 401 mired
+    {255, 157,  65},  // 409 mired
+    {255, 155,  60},  // 417 mired
+    {255, 153,  56},  // 425 mired
+    {255, 151,  51},  // 433 mired
+    {255, 149,  47},  // 441 mired
+    {255, 148,  42},  // 449 mired
+    {255, 146,  38},  // 457 mired
+    {255, 144,  33},  // 465 mired
+    {255, 142,  29},  // 473 mired
+    {255, 141,  24},  // 481 mired
+    {255, 139,  20},  // 489 mired
+    {255, 137,  16},  // 497 mired
+    {255, 136,  11},  // 505 mired
+};
+
+/**
+ * RGB for a color temperature in mired, clamped to the Home Assistant range
+ * and linearly interpolated between table entries.
+ */
+CRGB ColorTemperature::fromMired(uint16_t mired) {
+  if (mired < MIRED_MIN)
+    mired = MIRED_MIN;
+  if (mired > MIRED_MAX)
+    mired = MIRED_MAX;
+
+  uint16_t offset = mired - MIRED_MIN;
+  uint8_t i = offset / MIRED_STEP;
+  uint8_t frac = (offset % MIRED_STEP) * 256 / MIRED_STEP;
+
+  const uint8_t* a = table[i];
+  const uint8_t* b = table[i + 1];
+
+  return CRGB(a[0] + (((b[0] - a[0]) * frac) >> 8),
+              a[1] + (((b[1] - a[1]) * frac) >> 8),
+              a[2] + (((b[2] - a[2]) * frac) >> 8));
+}
@@ -0,0 +1,29 @@
+/**
+ * Color temperature to RGB.
+ *
+ * Home Assistant sends color_temp in mired (153-500). fromMired() looks the
+ * value up in a precomputed table and interpolates, so no floating point
+ * runs in the MQTT callback.
+ */
+#ifndef ColorTemperature_h
+#define ColorTemperature_h
+
+#include <Arduino.h>
+#include <FastLED.h>
+
+namespace ColorTemperature {
+
+const uint16_t MIRED_MIN = 153;
+const uint16_t MIRED_MAX = 500;
+const uint8_t MIRED_STEP = 8;
+const uint8_t TABLE_SIZE =
+    (MIRED_MAX - MIRED_MIN + MIRED_STEP - 1) / MIRED_STEP + 1;
+
+/** Table entry i is the color at MIRED_MIN + i * MIRED_STEP. */
+extern const uint8_t table[TABLE_SIZE][3];
+
+CRGB fromMired(uint16_t mired);
+
+}  // namespace ColorTemperature
+
+#endif  // ColorTemperature_h
@@ -1,44 +1,41 @@
 
 #include "Effects.hpp"
 
+#include "Animation.hpp"
+#include "ColorTemperature.hpp"
+#include "Palettes.hpp"
+
 #if defined(FFT_ACTIVE) && defined(TEENSY)
 #include <AudioFFT.h>
 AudioFFT fft;
 #endif
 
-#if defined(FFT_ACTIVE) && defined(ESP32)
+#if defined(FFT_ACTIVE) && (defined(ESP32) || defined(NATIVE))
 #include <Esp32FFT.h>
 Esp32FFT fft;
 #endif
 
-DEFINE_GRADIENT_PALETTE(Paired_07_gp){
-    0,   83,  159, 190, 36,  83,  159, 190, 36,  1,   48,  106, 72,  1,
-    48,  106, 72,  100, 189, 54,  109, 100, 189, 54,  109, 3,   91,  3,
-    145, 3,   91,  3,   145, 244, 84,  71,  182, 244, 84,  71,  182, 188,
-    1,   1,   218, 188, 1,   1,   218, 249, 135, 31,  255, 249, 135, 31};
-
-DEFINE_GRADIENT_PALETTE(bhw1_05_gp){0, 1, 221, 53, 255, 73, 3, 178};
-DEFINE_GRADIENT_PALETTE(RdYlBu_gp){
-    0,   82, 0,   2,   31,  163, 6,   2,   63,  227, 39,  9,  95,  249,
-    109, 22, 127, 252, 191, 61,  127, 182, 229, 237, 159, 90, 178, 203,
-    191, 32, 108, 155, 223, 8,   45,  106, 255, 3,   8,   66};
-
-DEFINE_GRADIENT_PALETTE(Sunset_Real_gp){
-    0,  120, 0,   0,   22, 179, 22,  0,  51, 255, 104, 0, 85, 167,
-    22, 18,  135, 100, 0,  103, 198, 16, 0,  130, 255, 0, 0,  160};
-
-DEFINE_GRADIENT_PALETTE(summer_gp){
-    0,   0,   55,  25, 17,  1,   62,  25, 33,  1,   72,  25, 51,  3,   82,  25,
-    68,  8,   92,  25, 84,  14,  104, 25, 102, 23,  115, 25, 119, 35,  127, 25,
-    135, 48,  141, 25, 153, 67,  156, 25, 170, 88,  169, 25, 186, 112, 186, 25,
-    204, 142, 201, 25, 221, 175, 217, 25, 237, 210, 235, 25, 255, 255, 255, 25};
-
-DEFINE_GRADIENT_PALETTE(gr65_hult_gp){0,   247, 176, 247, 48,  255, 136, 255,
-                                      89,  220, 29,  226, 160, 7,   82,  178,
-                                      216, 1,   124, 109, 255, 1,   124, 109};
-
 using namespace Effects;
 
+/**
+ * Buckets for the music effects. Below full quality they only ask for a new
+ * spectrum every few renders and otherwise take the one the analyser has.
+ */
+static std::array<uint8_t, FFT_BUCKETS> sampleFft(Governor::Quality quality) {
+  static uint8_t renders = 0;
+  uint8_t reuse = (quality == Governor::Quality::Minimal)   ? 4
+                  : (quality == Governor::Quality::Reduced) ? 2
+                                                            : 1;
+  if (++renders < reuse)
+    return fft.getBuckets();
+
+  renders = 0;
+  uint32_t start = Profiler::cycles();
+  std::array<uint8_t, FFT_BUCKETS> buckets = fft.getSampleSet();
+  Profiler::record(Profiler::Stage::Fft, Profiler::cycles() - start);
+  return buckets;
+}
+
 void Effects::Controller::setup(CRGB* l,
                                 const uint16_t n,
                                 LightState::LightState s) {
@@ -50,10 +47,12 @@ void Effects::Controller::setup(CRGB* l,
   leds = l;
   state = s;
 
-#if defined(FFT_ACTIVE) && defined(ESP32)
+#if defined(FFT_ACTIVE) && (defined(ESP32) || defined(NATIVE))
   fft.setup();
 #endif
 
+  Palettes::setup();
+  Layout::setup(numberOfLeds);
   setInitialState();
 }
 
@@ -64,7 +63,7 @@ void Effects::Controller::setInitialState() {
   CRGBSet ledset(leds, numberOfLeds);
 
   if (state.state == false) {
-    FastLED.setBrightness(0);
+    setBrightness16(0);
     return;
   }
 
@@ -91,7 +90,13 @@ void Effects::Controller::handleStateChange(LightState::LightState s) {
   Serial.printf("[effects] got state change: %s\n", state.state ? "ON" : "OFF");
 
   if (state.state == false) {
-    FastLED.setBrightness(0);
+    // Fades out only when asked to, off is otherwise immediate.
+    if (state.status.hasTransition) {
+      setCurrentCommand(Effects::Command::Brightness);
+    } else {
+      finishCommand(Effects::Command::Brightness);
+      setBrightness16(0);
+    }
     return;
   }
 
@@ -103,6 +108,36 @@ void Effects::Controller::handleStateChange(LightState::LightState s) {
     }
   }
 
+  if (state.status.hasLayers) {
+#ifdef DEBUG
+    Serial.printf("[effects]   Got %i layers\n", state.layerCount);
+#endif
+    clearLayers();
+    for (uint8_t i = 0; i < state.layerCount; i++) {
+      const LightState::Layer &layer = state.layers[i];
+      setLayer(i, getEffectFromString(layer.effect),
+               getBlendFromString(layer.blend), layer.opacity);
+    }
+  }
+
+  if (state.status.hasZones) {
+#ifdef DEBUG
+    Serial.printf("[effects]   Got %i zones\n", state.zoneCount);
+#endif
+    // Zones left out go back to the main effect.
+    uint8_t before = activeZones;
+    for (uint8_t z = 0; z < Layout::MAX_SHELVES; z++) {
+      setZoneEffect(z, (z < state.zoneCount)
+                           ? getEffectFromString(state.zones[z])
+                           : Effect::NoEffect);
+    }
+
+    // A plain color is not redrawn, so fade the freed shelves back to it.
+    if ((before & ~activeZones) &&
+        getCurrentEffect() == Effects::Effect::NullEffect)
+      setCurrentCommand(Effects::Command::Color);
+  }
+
   if (state.status.hasBrightness) {
 #ifdef DEBUG
     Serial.printf("[effects]   Got new brightness: '%i'\n", state.brightness);
@@ -121,77 +156,34 @@ void Effects::Controller::handleStateChange(LightState::LightState s) {
       Serial.printf("[effects]   effect is: '%s' hue: %.2f\n",
                     state.effect.c_str(), state.color.h);
 #endif
-      setStartHue(state.color.h);
+      hueTarget = static_cast<uint8_t>(state.color.h * (256.0 / 360.0));
+      setCurrentCommand(Effects::Command::Hue);
     }
   }
 
   if (state.status.hasColorTemp) {
-    unsigned int kelvin = (1000000 / state.color_temp);
+    unsigned int kelvin =
+        state.color_temp ? (1000000 / state.color_temp) : 0;
 #ifdef DEBUG
     Serial.printf("[effects]   Got color temp: %i mired = %i Kelvin\n",
                   state.color_temp, kelvin);
 #endif
 
-    unsigned int temp = kelvin / 100;
-
-    double red = 0;
-    if (temp <= 66) {
-      red = 255;
-    } else {
-      red = temp - 60;
-      red = 329.698727446 * (pow(red, -0.1332047592));
-      if (red < 0)
-        red = 0;
-      if (red > 255)
-        red = 255;
-    }
-
-    double green = 0;
-    if (temp <= 66) {
-      green = temp;
-      green = 99.4708025861 * log(green) - 161.1195681661;
-      if (green < 0)
-        green = 0;
-      if (green > 255)
-        green = 255;
-    } else {
-      green = temp - 60;
-      green = 288.1221695283 * (pow(green, -0.0755148492));
-      if (green < 0)
-        green = 0;
-      if (green > 255)
-        green = 255;
-    }
-
-    double blue = 0;
-    if (temp >= 66) {
-      blue = 255;
-    } else {
-      if (temp <= 19) {
-        blue = 0;
-      } else {
-        blue = temp - 10;
-        blue = 138.5177312231 * log(blue) - 305.0447927307;
-        if (blue < 0)
-          blue = 0;
-        if (blue > 255)
-          blue = 255;
-      }
-    }
+    CRGB rgb = ColorTemperature::fromMired(state.color_temp);
 
 #ifdef DEBUG
-    Serial.printf("[effects]   RGB [%i, %i, %i]\n", static_cast<uint8_t>(red),
-                  static_cast<uint8_t>(green), static_cast<uint8_t>(blue));
+    Serial.printf("[effects]   RGB [%i, %i, %i]\n", rgb.r, rgb.g, rgb.b);
 #endif
-    state.color.r = static_cast<uint8_t>(red);
-    state.color.g = static_cast<uint8_t>(green);
-    state.color.b = static_cast<uint8_t>(blue);
+    state.color.r = rgb.r;
+    state.color.g = rgb.g;
+    state.color.b = rgb.b;
 
     setCurrentCommand(Effects::Command::Color);
   }
 
   if (!state.status.hasColorTemp && !state.status.hasColor &&
-      !state.status.hasBrightness && !state.status.hasEffect) {
+      !state.status.hasBrightness && !state.status.hasEffect &&
+      !state.status.hasLayers && !state.status.hasZones) {
     // assuming turn on is the only thing.
     setCurrentCommand(Effects::Command::Brightness);
     setCurrentCommand(Effects::Command::Color);
@@ -203,27 +195,51 @@ void Effects::Controller::handleStateChange(LightState::LightState s) {
 //   lightState = l;
 // }
 
-void Effects::Controller::setCommandFrames(uint16_t i) {
-  commandFrames = i;
+/**
+ * Length of transitions in ms: the transition Home Assistant sent with the
+ * state, DEFAULT_TRANSITION when it did not send one.
+ */
+uint32_t Effects::Controller::getTransitionMillis() {
+  if (!state.status.hasTransition)
+    return DEFAULT_TRANSITION;
+  return state.transition * 1000;
 }
 
+/**
+ * Starts a command in its own slot, restarting it if it was already running.
+ * Transitions start from wherever the previous one got to.
+ */
 void Effects::Controller::setCurrentCommand(Command cmd) {
   // LightState::LightState& state = lightState->getCurrentState();
-  commandFrameCount = 0;
-  commandStart = millis();
   currentCommandType = cmd;
 
-  setCommandFrames(FPS * (state.transition || 1));
-
   switch (cmd) {
     case Command::Brightness:
-      cmdQueue[Command::Brightness] = [this]() { cmdSetBrightness(); };
+      brightnessFrom = brightness16;
+      Animation::begin(commands[cmd].tween, getTransitionMillis(),
+                       Animation::Easing::EaseInOut);
+      activeCommands |= (1 << cmd);
       break;
     case Command::Color:
-      cmdQueue[Command::Color] = [this]() { cmdFadeTowardColor(); };
+#ifdef HDR_OUTPUT
+      memcpy(colorFrom, hdr, sizeof(colorFrom));
+#else
+      memcpy(colorFrom, leds, numberOfLeds * sizeof(CRGB));
+#endif
+      Animation::begin(commands[cmd].tween, getTransitionMillis(),
+                       Animation::Easing::Linear);
+      activeCommands |= (1 << cmd);
+      break;
+    case Command::Hue:
+      hueFrom = effectState.startHue;
+      hueShifted = 0;
+      Animation::begin(commands[cmd].tween, getTransitionMillis(),
+                       Animation::Easing::EaseInOut);
+      activeCommands |= (1 << cmd);
       break;
     case Command::FirmwareUpdate:
-      cmdQueue[Command::FirmwareUpdate] = [this]() { cmdFirmwareUpdate(); };
+      Animation::begin(commands[cmd].tween, 0, Animation::Easing::Linear);
+      activeCommands |= (1 << cmd);
       break;
     default:
       // currentCommand = &Effects::Controller::cmdEmpty;
@@ -231,6 +247,27 @@ void Effects::Controller::setCurrentCommand(Command cmd) {
   }
 }
 
+void Effects::Controller::finishCommand(Command cmd) {
+  activeCommands &= ~(1 << cmd);
+}
+
+uint32_t Effects::Controller::getCommandStart(Command cmd) {
+  return commands[cmd].tween.start;
+}
+
+/**
+ * Brightness with 16 bit resolution, so transitions do not step. FastLED gets
+ * the top 8 bits for builds without HDR output.
+ */
+void Effects::Controller::setBrightness16(uint16_t brightness) {
+  brightness16 = brightness;
+  FastLED.setBrightness(brightness >> 8);
+}
+
+uint16_t Effects::Controller::getBrightness16() {
+  return brightness16;
+}
+
 Effects::Effect Effects::Controller::getEffectFromString(std::string str) {
   if (str == "Glitter Rainbow")
     return Effect::GlitterRainbow;
@@ -264,189 +301,639 @@ Effects::Effect Effects::Controller::getEffectFromString(std::string str) {
   return Effect::NullEffect;
 }
 
+/**
+ * Name of an effect as getEffectFromString() takes it, "none" for the rest.
+ */
+const char* Effects::Controller::getEffectName(Effect effect) {
+  switch (effect) {
+    case Effect::GlitterRainbow:
+      return "Glitter Rainbow";
+    case Effect::Rainbow:
+      return "Rainbow";
+    case Effect::Gradient:
+      return "Gradient";
+    case Effect::RainbowByShelf:
+      return "RainbowByShelf";
+    case Effect::BPM:
+      return "BPM";
+    case Effect::Confetti:
+      return "Confetti";
+    case Effect::Juggle:
+      return "Juggle";
+    case Effect::Sinelon:
+      return "Sinelon";
+    case Effect::VUMeter:
+      return "VUMeter";
+    case Effect::Frequencies:
+      return "Frequencies";
+    case Effect::MusicDancer:
+      return "Music Dancer";
+    case Effect::Pride:
+      return "Pride";
+    case Effect::Colorloop:
+      return "Colorloop";
+    case Effect::WalkingRainbow:
+      return "Walking Rainbow";
+    default:
+      return "none";
+  }
+}
+
+Pixels::Blend Effects::Controller::getBlendFromString(std::string str) {
+  if (str == "max")
+    return Pixels::Blend::Max;
+  if (str == "alpha")
+    return Pixels::Blend::Alpha;
+  if (str == "multiply")
+    return Pixels::Blend::Multiply;
+
+  return Pixels::Blend::Add;
+}
+
+/**
+ * Switches effect by name. With a transition the new effect starts from
+ * black and fades in over the old one, which keeps running until it is
+ * gone. Otherwise, and when switching to a plain color, the strip is
+ * cleared.
+ */
 void Effects::Controller::setCurrentEffect(std::string effect) {
 #ifdef DEBUG
   Serial.printf("[effects] setting effect: %s\n", effect.c_str());
 #endif
 
-  fill_solid(leds, LED_COUNT, CRGB::Black);
-  setCurrentEffect(getEffectFromString(effect));
+  Effect next = getEffectFromString(effect);
+
+  if (next < Effect::NullEffect && getTransitionMillis() > 0 &&
+      quality != Governor::Quality::Minimal) {
+    startCrossfade(getTransitionMillis());
+  } else {
+    fading = false;
+    Pixels::fill(leds, numberOfLeds, CRGB::Black);
+  }
+
+  if (base != nullptr)
+    Pixels::fill(base, numberOfLeds, CRGB::Black);
+#ifdef HDR_OUTPUT
+  Hdr::widen(leds, hdr, numberOfLeds);
+#endif
+  setCurrentEffect(next);
 }
 
 void Effects::Controller::setCurrentEffect(Effect effect) {
   // LightState::LightState& state = lightState->getCurrentState();
-  currentEffectType = effect;
+  currentEffectType =
+      (effect < Effect::NullEffect) ? effect : Effect::NullEffect;
+
+  // Commands draw a plain color straight on the strip.
+  if (currentEffectType == Effect::NullEffect)
+    fading = false;
+
+  effectNext = Clock::micros();
+  effectLast = Clock::millis();
+  startEffectState(effectState);
+}
+
+/**
+ * Runs effect on another zone (shelf) than the rest of the strip, or back
+ * with the rest of the strip for NoEffect. The zone renders into its own
+ * buffer, as long as the shelf and allocated the first time the zone gets an
+ * effect.
+ */
+void Effects::Controller::setZoneEffect(uint8_t zone, Effect effect) {
+  if (zone >= Layout::MAX_SHELVES)
+    return;
+
+  ZoneSlot& slot = zones[zone];
+  if (effect >= Effect::NullEffect || zone >= Layout::shelfCount()) {
+    slot.effect = Effect::NoEffect;
+    activeZones &= ~(1 << zone);
+    return;
+  }
+
+  uint16_t count;
+  Layout::shelfPixels(zone, count);
+  if (slot.leds == nullptr) {
+    slot.leds = new CRGB[count];
+  }
+
+  Pixels::fill(slot.leds, count, CRGB::Black);
+  slot.effect = effect;
+  slot.next = Clock::micros();
+  slot.last = Clock::millis();
+  slot.state = effectState;
+  startEffectState(slot.state);
+  activeZones |= (1 << zone);
+}
+
+Effects::Effect Effects::Controller::getZoneEffect(uint8_t zone) {
+  if (zone >= Layout::MAX_SHELVES || !(activeZones & (1 << zone)))
+    return Effect::NoEffect;
+  return zones[zone].effect;
+}
+
+/**
+ * Puts effect on layer index of the stack drawn over the main effect. Layers
+ * render into their own buffer and the main effect into base while there is
+ * something to blend, both allocated the first time they are needed.
+ */
+void Effects::Controller::setLayer(uint8_t index,
+                                   Effect effect,
+                                   Pixels::Blend blend,
+                                   uint8_t opacity) {
+  if (index >= MAX_LAYERS)
+    return;
+
+  bool visible = hasVisibleLayers();
+
+  LayerSlot& slot = layers[index];
+  if (slot.leds == nullptr) {
+    slot.leds = new CRGB[numberOfLeds];
+  }
+  if (base == nullptr) {
+    base = new CRGB[numberOfLeds];
+  }
+
+  Pixels::fill(slot.leds, numberOfLeds, CRGB::Black);
+  slot.effect = (effect < Effect::NullEffect) ? effect : Effect::NoEffect;
+  slot.blend = blend;
+  slot.opacity = opacity;
+  slot.next = Clock::micros();
+  slot.last = Clock::millis();
+  slot.state = effectState;
+  startEffectState(slot.state);
+
+  if (index >= layerCount)
+    layerCount = index + 1;
+
+  // The main effect goes on from what is on the strip.
+  if (!visible && !fading)
+    memcpy(base, leds, numberOfLeds * sizeof(CRGB));
+}
+
+/**
+ * Moves the running effect, or whatever color is on the strip, to the
+ * outgoing slot. Both buffers are allocated on the first crossfade and kept.
+ */
+void Effects::Controller::startCrossfade(uint32_t duration) {
+  if (outgoing.leds == nullptr) {
+    outgoing.leds = new CRGB[numberOfLeds];
+  }
+  if (base == nullptr) {
+    base = new CRGB[numberOfLeds];
+    memcpy(base, leds, numberOfLeds * sizeof(CRGB));
+  }
+
+  // Without layers or a crossfade the effect has been drawing on the strip.
+  bool composite = fading || hasVisibleLayers();
+  memcpy(outgoing.leds, composite ? base : leds, numberOfLeds * sizeof(CRGB));
+
+  outgoing.effect = currentEffectType;
+  outgoing.next = effectNext;
+  outgoing.last = effectLast;
+  outgoing.state = effectState;
+  outgoing.start = Clock::millis();
+  outgoing.duration = duration;
+  fading = true;
+}
+
+void Effects::Controller::clearLayers() {
+  layerCount = 0;
+}
+
+/**
+ * Whether any layer adds something to the main effect. Layers need an
+ * effect under them, they are not drawn over a plain color.
+ */
+bool Effects::Controller::hasVisibleLayers() {
+  if (currentEffectType >= Effect::NullEffect ||
+      quality == Governor::Quality::Minimal)
+    return false;
+
+  for (uint8_t i = 0; i < layerCount; i++) {
+    if (layers[i].opacity > 0 && layers[i].effect < Effect::NullEffect)
+      return true;
+  }
+  return false;
+}
+
+/**
+ * Renders effect into leds with s as its state.
+ */
+void Effects::Controller::runEffect(Effect effect,
+                                    const Frame& frame,
+                                    EffectState& s) {
+  fx = &s;
 
   switch (effect) {
     case Effect::GlitterRainbow:
-      currentEffect = [this]() { effectGlitterRainbow(); };
+      effectGlitterRainbow(frame);
       break;
     case Effect::Rainbow:
-      currentEffect = [this]() { effectRainbow(); };
+      effectRainbow(frame);
       break;
     case Effect::Gradient:
-      currentEffect = [this]() { effectGradient(); };
+      effectGradient(frame);
       break;
     case Effect::RainbowByShelf:
-      currentEffect = [this]() { effectRainbowByShelf(); };
+      effectRainbowByShelf(frame);
       break;
     case Effect::BPM:
-      currentEffect = [this]() { effectBPM(); };
+      effectBPM(frame);
       break;
     case Effect::Pride:
-      currentEffect = [this]() { effectPride(); };
+      effectPride(frame);
       break;
     case Effect::Colorloop:
-      currentEffect = [this]() { effectColorloop(); };
+      effectColorloop(frame);
       break;
     case Effect::WalkingRainbow:
-      currentEffect = [this]() { effectWalkingRainbow(); };
+      effectWalkingRainbow(frame);
       break;
     case Effect::VUMeter:
-      currentEffect = [this]() { effectVUMeter(); };
+      effectVUMeter(frame);
       break;
     case Effect::MusicDancer:
-      currentEffect = [this]() { effectMusicDancer(); };
+      effectMusicDancer(frame);
       break;
     case Effect::Frequencies:
-      currentEffect = [this]() { effectFrequencies(); };
+      effectFrequencies(frame);
       break;
     case Effect::Confetti:
-      currentEffect = [this]() { effectConfetti(); };
+      effectConfetti(frame);
       break;
     case Effect::Sinelon:
-      currentEffect = [this]() { effectSinelon(); };
+      effectSinelon(frame);
       break;
     case Effect::Juggle:
-      currentEffect = [this]() { effectJuggle(); };
+      effectJuggle(frame);
       break;
     default:
-      currentEffectType = Effect::NullEffect;
-      currentEffect = [this]() {};
+      break;
   }
+
+  fx = &effectState;
 }
 
-void Effects::Controller::runCurrentCommand() {
-  for (auto func : cmdQueue) {
-    func.second();
-  }
+/**
+ * Starts the timers of s over, for an effect that starts now.
+ */
+void Effects::Controller::startEffectState(EffectState& s) {
+  s.paletteChanged = Clock::millis();
+  s.hueStepped = Clock::millis();
 }
 
-void Effects::Controller::runCurrentEffect() {
-  this->currentEffect();
+/**
+ * Whether period ms have passed since last in frame time, last is moved on
+ * to now when they have.
+ */
+bool Effects::Controller::isTimeFor(uint32_t& last, uint32_t period) {
+  if (frame.time - last < period)
+    return false;
+
+  last = frame.time;
+  return true;
 }
 
-void Effects::Controller::cmdEmpty() {}
+/**
+ * Whether an effect with its own update rate should render this frame, next
+ * is when it is due in us and is moved on when it is.
+ */
+bool Effects::Controller::isEffectDue(Effect effect, uint32_t& next) {
+  uint8_t rate = getEffectRate(effect);
+  if (rate == 0)
+    return true;
+
+  uint32_t now = Clock::micros();
+  if (static_cast<int32_t>(now - next) < 0)
+    return false;
+
+  next += 1000000 / rate;
+  if (static_cast<int32_t>(now - next) >= 0)
+    next = now + 1000000 / rate;
+  return true;
+}
 
-void Effects::Controller::cmdFirmwareUpdate() {
-  fill_solid(leds, LED_COUNT, CRGB::Black);
-  // fill_solid(leds, 15, CRGB::White);
-  leds[3] = CRGB::White;
-  leds[7] = CRGB::White;
-  leds[11] = CRGB::White;
-  leds[15] = CRGB::White;
-  leds[16] = CRGB::White;
+/**
+ * Update rate in Hz for effects that animate slower than the output, 0 means
+ * every frame.
+ */
+uint8_t Effects::Controller::getEffectRate(Effect effect) {
+  switch (effect) {
+    case Effect::Colorloop:
+      return 10;
+    case Effect::VUMeter:
+      return 25;
+    case Effect::WalkingRainbow:
+      return 60;
+    default:
+      return 0;
+  }
+}
 
-  FastLED.show();
+const Frame& Effects::Controller::getFrame() {
+  return frame;
 }
 
-void Effects::Controller::cmdSetBrightness() {
-  // LightState::LightState state = lightState->getCurrentState();
+/**
+ * Output frame period in us, FRAME_MICROS unless the governor lowered it.
+ */
+void Effects::Controller::setFrameMicros(uint32_t micros) {
+  frameMicros = micros;
+}
+
+/**
+ * How much effects may spend on a frame. Reduced stops rendering the
+ * outgoing effect of a crossfade, its last frame fades out instead, and
+ * samples the FFT every other render. Minimal also cuts crossfades, skips
+ * layers and samples the FFT every fourth render.
+ */
+void Effects::Controller::setQuality(Governor::Quality q) {
+  bool visible = hasVisibleLayers();
+  quality = q;
+
+  if (quality == Governor::Quality::Minimal)
+    fading = false;
+  else if (!visible && hasVisibleLayers() && !fading)
+    memcpy(base, leds, numberOfLeds * sizeof(CRGB));
+}
 
-  uint8_t target = state.brightness;
-  uint8_t current = FastLED.getBrightness();
+Governor::Quality Effects::Controller::getQuality() {
+  return quality;
+}
 
-  EVERY_N_MILLIS(1000 / FPS) {
-    if (commandFrameCount < commandFrames) {
-      FastLED.setBrightness(
-          current + ((target - current) / (commandFrames - commandFrameCount)));
-      commandFrameCount++;
-    } else {
-#ifdef DEBUG
-      Serial.printf("[effects] command setting brightness DONE [%i] %lu ms.\n",
-                    FastLED.getBrightness(), (millis() - commandStart));
+/**
+ * Frame clock. Returns false until the next output frame is due, then runs
+ * commands and the current effect once and returns true so the caller can
+ * present the frame. Frames that are missed are dropped instead of rendered
+ * back to back.
+ */
+bool Effects::Controller::renderFrame() {
+  uint32_t now = Clock::micros();
+  if (now - frameStart < frameMicros)
+    return false;
+
+  frameStart += frameMicros;
+  if (now - frameStart >= frameMicros)
+    frameStart = now;
+
+  frame.index++;
+  frame.delta = Clock::millis() - frame.time;
+  frame.time = Clock::millis();
+
+  uint32_t start = Profiler::cycles();
+  runCurrentCommand();
+  uint32_t commandsDone = Profiler::cycles();
+  runCurrentEffect();
+  Profiler::record(Profiler::Stage::Command, commandsDone - start);
+  Profiler::record(Profiler::Stage::Effect, Profiler::cycles() - commandsDone);
+
+#ifdef HDR_OUTPUT
+  // Effects render 8 bit. Without one the color command owns the 16 bit
+  // frame.
+  if (currentEffectType != Effect::NullEffect || activeZones)
+    Hdr::widen(leds, hdr, numberOfLeds);
 #endif
 
-      // setCurrentCommand(Command::None);
-      cmdQueue.erase(Effects::Command::Brightness);
+  return true;
+}
+
+void Effects::Controller::runCurrentCommand() {
+  for (uint8_t i = 0; i < COMMAND_SLOTS; i++) {
+    if (activeCommands & (1 << i)) {
+      runCommand(static_cast<Command>(i));
     }
   }
 }
 
+void Effects::Controller::runCommand(Command cmd) {
+  switch (cmd) {
+    case Command::Brightness:
+      cmdSetBrightness();
+      break;
+    case Command::Color:
+      cmdFadeTowardColor();
+      break;
+    case Command::Hue:
+      cmdShiftHue();
+      break;
+    case Command::FirmwareUpdate:
+      cmdFirmwareUpdate();
+      break;
+    default:
+      finishCommand(cmd);
+  }
+}
+
+void Effects::Controller::runCurrentEffect() {
+  bool layered = hasVisibleLayers();
+  bool composite = fading || layered;
+  CRGB* strip = leds;
+
+  if (isEffectDue(currentEffectType, effectNext)) {
+    Frame effectFrame = frame;
+    effectFrame.delta = Clock::millis() - effectLast;
+    effectLast = Clock::millis();
+
+    if (composite)
+      leds = base;
+    runEffect(currentEffectType, effectFrame, effectState);
+    leds = strip;
+  }
+
+  if (composite)
+    memcpy(strip, base, numberOfLeds * sizeof(CRGB));
+
+  if (fading)
+    runOutgoing();
+
+  if (layered)
+    runLayers();
+
+  if (activeZones)
+    runZoneEffects();
+}
+
 /**
- * Helper function that blends one uint8_t toward another by a given amount
- * Taken from:
- * https://gist.github.com/kriegsman/d0a5ed3c8f38c64adcb4837dafb6e690
+ * Blends the outgoing effect over the new one, less every frame, and
+ * releases it once it is gone.
  */
-void Effects::Controller::nblendU8TowardU8(uint8_t& cur,
-                                           const uint8_t target,
-                                           uint8_t amount) {
-  if (cur == target)
+void Effects::Controller::runOutgoing() {
+  uint32_t elapsed = Clock::millis() - outgoing.start;
+  if (elapsed >= outgoing.duration) {
+#ifdef DEBUG
+    Serial.printf("[effects] crossfade done in %u ms.\n", elapsed);
+#endif
+    fading = false;
     return;
+  }
 
-  if (cur < target) {
-    uint8_t delta = target - cur;
-    delta = scale8_video(delta, amount);
-    cur += delta;
-  } else {
-    uint8_t delta = cur - target;
-    delta = scale8_video(delta, amount);
-    cur -= delta;
+  uint8_t opacity =
+      255 - static_cast<uint64_t>(elapsed) * 255 / outgoing.duration;
+  if (opacity == 0) {
+    fading = false;
+    return;
+  }
+
+  CRGB* strip = leds;
+  if (quality == Governor::Quality::Full &&
+      isEffectDue(outgoing.effect, outgoing.next)) {
+    Frame outgoingFrame = frame;
+    outgoingFrame.delta = Clock::millis() - outgoing.last;
+    outgoing.last = Clock::millis();
+
+    leds = outgoing.leds;
+    runEffect(outgoing.effect, outgoingFrame, outgoing.state);
+    leds = strip;
   }
+
+  Pixels::alpha(strip, outgoing.leds, numberOfLeds, opacity);
 }
 
 /**
- * Blend one CRGB color toward another CRGB color by a given amount.
- * Blending is linear, and done in the RGB color space.
- * This function modifies 'cur' in place.
- * Taken from:
- * https://gist.github.com/kriegsman/d0a5ed3c8f38c64adcb4837dafb6e690
+ * Blends the layers over the strip in order.
  */
-CRGB Effects::Controller::fadeTowardColor(CRGB& cur,
-                                          const CRGB& target,
-                                          uint8_t amount) {
-  nblendU8TowardU8(cur.red, target.red, amount);
-  nblendU8TowardU8(cur.green, target.green, amount);
-  nblendU8TowardU8(cur.blue, target.blue, amount);
-  return cur;
+void Effects::Controller::runLayers() {
+  CRGB* strip = leds;
+
+  for (uint8_t i = 0; i < layerCount; i++) {
+    LayerSlot& slot = layers[i];
+    if (slot.opacity == 0 || slot.effect >= Effect::NullEffect)
+      continue;
+
+    if (isEffectDue(slot.effect, slot.next)) {
+      Frame layerFrame = frame;
+      layerFrame.delta = Clock::millis() - slot.last;
+      slot.last = Clock::millis();
+
+      leds = slot.leds;
+      runEffect(slot.effect, layerFrame, slot.state);
+      leds = strip;
+    }
+
+    Pixels::blend(slot.blend, strip, slot.leds, numberOfLeds, slot.opacity);
+  }
 }
 
 /**
- * Fade an entire array of CRGBs toward a given background color by a given
- * amount This function modifies the pixel array in place. Taken from:
- * https://gist.github.com/kriegsman/d0a5ed3c8f38c64adcb4837dafb6e690
+ * Renders every zone effect as if its shelf were the whole strip, its pixels
+ * in strip order, and writes them to their places on the strip.
  */
-void Effects::Controller::fadeTowardColor(CRGB* L,
-                                          uint16_t N,
-                                          const CRGB& bgColor,
-                                          uint8_t fadeAmount) {
-  uint16_t check = 0;
-  EVERY_N_MILLIS(4) {
-    for (uint16_t i = 0; i < N; i++) {
-      fadeTowardColor(L[i], bgColor, fadeAmount);
-      if (L[i] == bgColor)
-        check++;
+void Effects::Controller::runZoneEffects() {
+  CRGB* strip = leds;
+  uint16_t stripLeds = numberOfLeds;
+
+  for (uint8_t z = 0; z < Layout::shelfCount(); z++) {
+    if (!(activeZones & (1 << z)))
+      continue;
+
+    ZoneSlot& slot = zones[z];
+    uint16_t count;
+    const uint16_t* pixels = Layout::shelfPixels(z, count);
+
+    if (isEffectDue(slot.effect, slot.next)) {
+      Frame zoneFrame = frame;
+      zoneFrame.delta = Clock::millis() - slot.last;
+      slot.last = Clock::millis();
+
+      leds = slot.leds;
+      numberOfLeds = count;
+      zonePixels = pixels;
+      runEffect(slot.effect, zoneFrame, slot.state);
+      leds = strip;
+      numberOfLeds = stripLeds;
+      zonePixels = nullptr;
+    }
+
+    for (uint16_t k = 0; k < count; k++) {
+      strip[pixels[k]] = slot.leds[k];
     }
   }
+}
+
+void Effects::Controller::cmdEmpty() {}
+
+void Effects::Controller::cmdFirmwareUpdate() {
+  Pixels::fill(leds, numberOfLeds, CRGB::Black);
+  // fill_solid(leds, 15, CRGB::White);
+  leds[3] = CRGB::White;
+  leds[7] = CRGB::White;
+  leds[11] = CRGB::White;
+  leds[15] = CRGB::White;
+  leds[16] = CRGB::White;
 
-  if (check == numberOfLeds) {
+  FastLED.show();
+}
+
+void Effects::Controller::cmdSetBrightness() {
+  // LightState::LightState state = lightState->getCurrentState();
+
+  CommandSlot& slot = commands[Command::Brightness];
+  int32_t target = state.state ? Hdr::widen(state.brightness) : 0;
+  uint32_t progress = Animation::progress(slot.tween, Clock::millis());
+
+  setBrightness16(Animation::lerp(brightnessFrom, target, progress));
+
+  if (progress == Animation::PROGRESS_END) {
 #ifdef DEBUG
-    Serial.printf("[effects] fade towards color done in %lu ms.\n",
-                  (millis() - commandStart));
+    Serial.printf("[effects] command setting brightness DONE [%i] %u ms.\n",
+                  FastLED.getBrightness(), (Clock::millis() - slot.tween.start));
 #endif
+
     // setCurrentCommand(Command::None);
-    cmdQueue.erase(Effects::Command::Color);
+    finishCommand(Command::Brightness);
   }
 }
 
 /**
- * command tells strip to Fade towards a color
+ * command tells strip to Fade towards a color, from the pixels it had when
+ * the command started.
  */
 void Effects::Controller::cmdFadeTowardColor() {
   // LightState::LightState state = lightState->getCurrentState();
+  CommandSlot& slot = commands[Command::Color];
   CRGB targetColor(state.color.r, state.color.g, state.color.b);
+  uint32_t progress = Animation::progress(slot.tween, Clock::millis());
+
+#ifdef HDR_OUTPUT
+  Hdr::CRGB16 target = Hdr::widen(targetColor);
+  for (uint16_t i = 0; i < numberOfLeds; i++) {
+    hdr[i].r = Animation::lerp(colorFrom[i].r, target.r, progress);
+    hdr[i].g = Animation::lerp(colorFrom[i].g, target.g, progress);
+    hdr[i].b = Animation::lerp(colorFrom[i].b, target.b, progress);
+  }
+  Hdr::narrow(hdr, leds, numberOfLeds);
+#else
+  Pixels::lerpToward(leds, colorFrom, numberOfLeds, targetColor,
+                     progress >> 8);
+#endif
+
+  if (progress == Animation::PROGRESS_END) {
+#ifdef DEBUG
+    Serial.printf("[effects] fade towards color done in %u ms.\n",
+                  (Clock::millis() - slot.tween.start));
+#endif
+    finishCommand(Command::Color);
+  }
+}
 
-  fadeTowardColor(leds, numberOfLeds, targetColor, 2);
+/**
+ * Turns the start hue of the running effect toward hueTarget the short way
+ * round. Only the change since the last frame is added, so effects that
+ * move the hue themselves keep doing so.
+ */
+void Effects::Controller::cmdShiftHue() {
+  CommandSlot& slot = commands[Command::Hue];
+  int8_t distance = hueTarget - hueFrom;
+  uint32_t progress = Animation::progress(slot.tween, Clock::millis());
+
+  int8_t shifted = Animation::lerp(0, distance, progress);
+  effectState.startHue += shifted - hueShifted;
+  hueShifted = shifted;
+
+  if (progress == Animation::PROGRESS_END) {
+    effectState.confettiHue = effectState.startHue;
+    finishCommand(Command::Hue);
+  }
 }
 
 /**
@@ -463,60 +950,44 @@ Effects::Effect Effects::Controller::getCurrentEffect() {
  * Sets the start hue
  */
 void Effects::Controller::setStartHue(float hue) {
-  startHue = static_cast<uint8_t>(hue * (256.0 / 360.0));
-  confettiHue = startHue;
+  effectState.startHue = static_cast<uint8_t>(hue * (256.0 / 360.0));
+  effectState.confettiHue = effectState.startHue;
 }
 
 // =====================================================================
 // EFFECTS
 // =====================================================================
-void Effects::Controller::effectRainbow() {
+void Effects::Controller::effectRainbow(const Frame& frame) {
   // fills the leds with rainbow colors
-  fill_rainbow(leds, numberOfLeds, startHue, 2);
+  fill_rainbow(leds, numberOfLeds, fx->startHue, 2);
 }
 
 uint16_t GRAD_INDEX = 0;
-CRGBPalette256 pal = Sunset_Real_gp;
-uint8_t j = 0;
-
-void Effects::Controller::effectGradient() {
-  CRGBPalette256 palettes[6] = {RdYlBu_gp, Paired_07_gp, bhw1_05_gp,
-                                summer_gp, gr65_hult_gp, Sunset_Real_gp};
-
-  EVERY_N_SECONDS(30) {
-    Serial.printf("  - effect Gradient #: %i\n", j);
-    pal = palettes[j];
-    j = (j < 5) ? j + 1 : 0;
+void Effects::Controller::effectGradient(const Frame& frame) {
+  if (isTimeFor(fx->paletteChanged, 30000)) {
+    fx->gradientPalette = Palettes::next(fx->gradientPalette);
+    Serial.printf("  - effect Gradient #: %i\n", fx->gradientPalette);
   }
 
-  uint8_t step = (256 / LED_COUNT);
+  uint8_t step = (256 / numberOfLeds);
 
   // EVERY_N_MILLIS(1000 / FPS) { GRAD_INDEX++; }
-  EVERY_N_MILLIS(1000 / FPS) {
-    GRAD_INDEX = beatsin16(2, 0, 257 * 8);
-    fill_palette(leds, LED_COUNT, GRAD_INDEX, step, pal, 255, LINEARBLEND);
-    // fill_palette(end, (LED_COUNT / 2) - 1, REV_INDEX, step, pal, 255,
-    //              LINEARBLEND);
-    // end = start;
-  }
+  GRAD_INDEX = beatsin16(2, 0, 257 * 8);
+  fill_palette(leds, numberOfLeds, GRAD_INDEX, step,
+               Palettes::get(fx->gradientPalette), 255, LINEARBLEND);
+  // fill_palette(end, (LED_COUNT / 2) - 1, REV_INDEX, step, pal, 255,
+  //              LINEARBLEND);
+  // end = start;
 }
 
-void Effects::Controller::effectRainbowByShelf() {
-  CRGBSet ledset(leds, numberOfLeds);
-  ledset(0, 63).fill_rainbow(startHue, 4);
-  ledset(64, 127) = ledset(63, 0);
-
-  if (numberOfLeds < 131)
-    return;
-
-  ledset(128, 191).fill_rainbow(startHue + 64, 4);
-  ledset(192, 255) = ledset(191, 128);
-
-  if (numberOfLeds < 257)
-    return;
-
-  ledset(256, 319).fill_rainbow(startHue + 128, 4);
-  ledset(320, 383) = ledset(319, 256);
+void Effects::Controller::effectRainbowByShelf(const Frame& frame) {
+  // A rainbow along every shelf, each shelf a quarter turn further on.
+  for (uint16_t i = 0; i < numberOfLeds; i++) {
+    uint16_t p = (zonePixels != nullptr) ? zonePixels[i] : i;
+    uint8_t hue =
+        fx->startHue + (Layout::shelf(p) * 64) + (Layout::position(p) * 4);
+    leds[i] = CHSV(hue, 255, 240);
+  }
 }
 
 void Effects::Controller::addGlitter(fract8 chanceOfGlitter) {
@@ -525,128 +996,121 @@ void Effects::Controller::addGlitter(fract8 chanceOfGlitter) {
   }
 }
 
-void Effects::Controller::effectGlitterRainbow() {
+void Effects::Controller::effectGlitterRainbow(const Frame& frame) {
   // built-in FastLED rainbow, plus some random sparkly glitter
-  effectRainbow();
-  EVERY_N_MILLIS(1000 / FPS) { addGlitter(160); }
+  effectRainbow(frame);
+  addGlitter(160);
 }
 
-void Effects::Controller::effectConfetti() {
+void Effects::Controller::effectConfetti(const Frame& frame) {
   // random colored speckles that blink in and fade smoothly
-  EVERY_N_SECONDS(2) { confettiHue = confettiHue + 8; }
-
-  EVERY_N_MILLIS(1000 / FPS) {
-    fadeToBlackBy(leds, numberOfLeds, 20);
-    int pos = random16(numberOfLeds);
-    // leds[pos] += CHSV(startHue + random8(64), 200, 255);
-    leds[pos] += CHSV(confettiHue + random8(64), 200, 255);
-    // leds[pos] += CHSV(confettiHue, 200, 255);
-  }
+  if (isTimeFor(fx->hueStepped, 2000))
+    fx->confettiHue = fx->confettiHue + 8;
+
+  Pixels::fadeToBlackBy(leds, numberOfLeds, 20);
+  int pos = random16(numberOfLeds);
+  // leds[pos] += CHSV(fx->startHue + random8(64), 200, 255);
+  leds[pos] += CHSV(fx->confettiHue + random8(64), 200, 255);
+  // leds[pos] += CHSV(fx->confettiHue, 200, 255);
 }
 
 // a colored dot sweeping back and forth, with fading trails
-void Effects::Controller::effectSinelon() {
-  EVERY_N_MILLIS(8) { fadeToBlackBy(leds, LED_COUNT, 16); }
+void Effects::Controller::effectSinelon(const Frame& frame) {
+  // 16 per 8 ms, independent of the frame rate.
+  Pixels::fadeToBlackBy(leds, numberOfLeds,
+                        (frame.delta < 128) ? frame.delta * 2 : 255);
 
-  EVERY_N_MILLIS(200) { startHue += 1; }
+  if (isTimeFor(fx->hueStepped, 200))
+    fx->startHue += 1;
   // LightState state = lightState->getCurrentState();
 
   // calculate a suiting pulserate for the number of leds.
-  uint8_t bpm = 750 / LED_COUNT;
+  uint8_t bpm = (numberOfLeds > 2) ? 750 / numberOfLeds : 255;
 
-  int pos = beatsin16(bpm, 0, LED_COUNT - 1);
-  leds[pos] = CHSV(startHue, 255, 255);
+  int pos = beatsin16(bpm, 0, numberOfLeds - 1);
+  leds[pos] = CHSV(fx->startHue, 255, 255);
   // leds[pos] += CRGB(state.color.r, state.color.g, state.color.b);
 }
 
 /**
  * colored stripes pulsing at a defined Beats-Per-Minute (BPM)
  */
-void Effects::Controller::effectBPM() {
+void Effects::Controller::effectBPM(const Frame& frame) {
   uint8_t BeatsPerMinute = 64;
-  CRGBPalette16 palette = PartyColors_p;
+  const CRGBPalette16& palette = Palettes::party();
   uint8_t beat = beatsin8(BeatsPerMinute, 64, 255);
   for (int i = 0; i < numberOfLeds; i++) {  // 9948
-    leds[i] = ColorFromPalette(palette, startHue + (i * 2),
-                               beat - startHue + (i * 10));
+    leds[i] = ColorFromPalette(palette, fx->startHue + (i * 2),
+                               beat - fx->startHue + (i * 10));
   }
 }
 
-void Effects::Controller::effectPride() {
-  CRGBSet ledset(leds, LED_COUNT);
-
-  uint8_t num_colors = 6;
-  uint8_t segment = LED_COUNT / num_colors;
+void Effects::Controller::effectPride(const Frame& frame) {
+  const uint8_t num_colors = 6;
+  uint16_t segment = numberOfLeds / num_colors;
 
   uint32_t colors[num_colors] = {0xEF0000, 0xFF4000, 0xFFEF00,
                                  0x008000, 0x0000F0, 0x800070};
 
-  for (int i = 0; i < num_colors; i++) {
-    ledset(i * segment, (i * segment) + segment) = colors[i];
+  // The last stripe also takes the leds left over at the end.
+  for (uint8_t i = 0; i < num_colors; i++) {
+    uint16_t first = i * segment;
+    uint16_t count = (i < num_colors - 1) ? segment : numberOfLeds - first;
+    Pixels::fill(leds + first, count, CRGB(colors[i]));
   }
 }
 
-void Effects::Controller::effectWalkingRainbow() {
-  EVERY_N_MILLIS(1000 / 60) {
-    uint8_t inc = 2;  // 256 / LED_COUNT;
-    uint8_t hue = startHue;
+void Effects::Controller::effectWalkingRainbow(const Frame& frame) {
+  uint8_t inc = 2;  // 256 / LED_COUNT;
+  uint8_t hue = fx->startHue;
 
-    for (int i = 0; i < LED_COUNT; i++) {
-      hue += inc;
-      leds[i] = CHSV(hue, 255, 255);
-    }
-
-    startHue--;
+  for (int i = 0; i < numberOfLeds; i++) {
+    hue += inc;
+    leds[i] = CHSV(hue, 255, 255);
   }
+
+  fx->startHue--;
 }
 
-void Effects::Controller::effectColorloop() {
+void Effects::Controller::effectColorloop(const Frame& frame) {
   // EVERY_N_SECONDS(2) { Serial.printf("  - Running colorloop: %i\n",
-  // startHue); }
+  // fx->startHue); }
 
-  EVERY_N_MILLIS(1000 / 10) {
-    CRGBSet ledset(leds, LED_COUNT);
-    startHue += 1;
-    ledset = CHSV(startHue, 255, 255);
-  }
+  fx->startHue += 1;
+  Pixels::fill(leds, numberOfLeds, CHSV(fx->startHue, 255, 255));
 }
 
 /** =====================================================================
  * FFT based spectrum analyzer disco lights
  */
-void Effects::Controller::effectVUMeter() {
-  CRGBSet ledset(leds, LED_COUNT);
-
-  EVERY_N_MILLIS(1000 / 25) {
-    ledset(0, LED_COUNT).fadeToBlackBy(96);
-    std::array<uint8_t, FFT_BUCKETS> buckets = fft.getSampleSet();
-
-    // ==================================================================
-    // Paint the colors
-    CRGBPalette16 palette = Rainbow_gp;
-    uint8_t segment = LED_COUNT / FFT_BUCKETS;  // how many leds per bucket
-    uint8_t step = 256 / FFT_BUCKETS;    // How many colors to jump per segment
-    uint8_t increment = step / segment;  // colors to increment inside segment
-
-    for (int i = 0; i < FFT_BUCKETS; i++) {
-      // map the value into number of leds to light.
-      uint8_t count = map(buckets[i], 0, 255, 0, segment);
-
-      if (count > 0) {
-        fill_palette(ledset(i * segment, i * segment + count), count, i * step,
-                     increment, palette, buckets[i], LINEARBLEND);
-      }
-      // buckets[i] = 0;
+void Effects::Controller::effectVUMeter(const Frame& frame) {
+  CRGBSet ledset(leds, numberOfLeds);
+
+  Pixels::fadeToBlackBy(leds, numberOfLeds, 96);
+  std::array<uint8_t, FFT_BUCKETS> buckets = sampleFft(quality);
+
+  // ==================================================================
+  // Paint the colors
+  const CRGBPalette16& palette = Palettes::rainbow();
+  uint16_t segment = numberOfLeds / FFT_BUCKETS;  // how many leds per bucket
+  uint8_t step = 256 / FFT_BUCKETS;  // How many colors to jump per segment
+  uint8_t increment = segment ? step / segment : 0;  // inside a segment
+
+  for (int i = 0; i < FFT_BUCKETS; i++) {
+    // map the value into number of leds to light.
+    uint16_t count = map(buckets[i], 0, 255, 0, segment);
+
+    if (count > 0) {
+      fill_palette(ledset(i * segment, i * segment + count), count, i * step,
+                   increment, palette, buckets[i], LINEARBLEND);
     }
+    // buckets[i] = 0;
   }
 }
 
-CRGBPalette256 colPal = Sunset_Real_gp;
-void Effects::Controller::effectMusicDancer() {
-  CRGBSet ledset(leds, LED_COUNT);
-  // ledset(0, LED_COUNT) = CRGB::Black;
+void Effects::Controller::effectMusicDancer(const Frame& frame) {
 
-  std::array<uint8_t, FFT_BUCKETS> buckets = fft.getSampleSet();
+  std::array<uint8_t, FFT_BUCKETS> buckets = sampleFft(quality);
   //   fftComputeSampleset();
   //   fftFillBuckets();
 
@@ -658,18 +1122,24 @@ void Effects::Controller::effectMusicDancer() {
     Serial.println();
   }
 
-  uint16_t middle = LED_COUNT / 2;
-
-  uint16_t bass_size = LED_COUNT / 10;
-  uint16_t mid_size = LED_COUNT / 10;
-  // uint16_t low_size = LED_COUNT / 10;
-
-  uint16_t bass_amp = map(buckets[0], 0, 255, 0, ((LED_COUNT / 10) * 2));
-  uint16_t mid_amp = map(buckets[2], 0, 255, 0, ((LED_COUNT / 10) * 2));
-  uint16_t low_amp = map(buckets[3], 0, 255, 0, (LED_COUNT / 2));
-  uint16_t high_amp = map(buckets[4], 0, 255, 0, (LED_COUNT / 2));
-  uint16_t bril_amp = map(buckets[5], 0, 255, 0, LED_COUNT);
-  uint16_t air_amp = map(buckets[6], 0, 255, 0, LED_COUNT);
+  uint16_t middle = numberOfLeds / 2;
+
+  uint16_t bass_size = numberOfLeds / 10;
+  uint16_t mid_size = numberOfLeds / 10;
+  // uint16_t low_size = numberOfLeds / 10;
+
+  // The parts are read from the same share of the spectrum whatever the
+  // number of buckets, air from the top one.
+  uint16_t bass_amp = map(buckets[0], 0, 255, 0, ((numberOfLeds / 10) * 2));
+  uint16_t mid_amp =
+      map(buckets[2 * FFT_BUCKETS / 6], 0, 255, 0, ((numberOfLeds / 10) * 2));
+  uint16_t low_amp =
+      map(buckets[3 * FFT_BUCKETS / 6], 0, 255, 0, (numberOfLeds / 2));
+  uint16_t high_amp =
+      map(buckets[4 * FFT_BUCKETS / 6], 0, 255, 0, (numberOfLeds / 2));
+  uint16_t bril_amp =
+      map(buckets[5 * FFT_BUCKETS / 6], 0, 255, 0, numberOfLeds);
+  uint16_t air_amp = map(buckets[FFT_BUCKETS - 1], 0, 255, 0, numberOfLeds);
 
   uint16_t bass_start = middle - bass_size;
   uint16_t bass_stop = middle + bass_size;
@@ -677,44 +1147,41 @@ void Effects::Controller::effectMusicDancer() {
   uint16_t mid_start = bass_start - mid_size;
   uint16_t mid_stop = bass_stop + mid_size;
 
-  ledset.fadeToBlackBy(48);
-  // ledset.fadeLightBy(48);
+  Pixels::fadeToBlackBy(leds, numberOfLeds, 48);
 
   // CRGBPalette16 colPal = bhw1_05_gp;
   // CRGBPalette16 colPal = Paired_07_gp;  // bhw1_05_gp
   // CRGBPalette16 colPal = Rainbow_gp;  // bhw1_05_gp
   // CRGBPalette256 colPal = Sunset_Real_gp;
-  CRGBPalette256 palettes[6] = {RdYlBu_gp, Paired_07_gp, bhw1_05_gp,
-                                summer_gp, gr65_hult_gp, Sunset_Real_gp};
-
-  EVERY_N_SECONDS(30) {
-    Serial.printf("  - effect Gradient #: %i\n", j);
-    colPal = palettes[j];
-    j = (j < 5) ? j + 1 : 0;
+  if (isTimeFor(fx->paletteChanged, 30000)) {
+    fx->dancerPalette = Palettes::next(fx->dancerPalette);
+    Serial.printf("  - effect Music Dancer palette #: %i\n", fx->dancerPalette);
   }
 
+  const CRGBPalette256& colPal = Palettes::get(fx->dancerPalette);
+
   uint8_t RAND = 32;
 
   for (int i = 0; i < high_amp; i++) {
-    uint16_t pos = random16(LED_COUNT);
+    uint16_t pos = random16(numberOfLeds);
     // leds[pos] = CHSV(96 + random8(16), 255, buckets[4]);
     leds[pos] = ColorFromPalette(colPal, 223 + random8(RAND));
   }
 
   for (int i = 0; i < bril_amp; i++) {
-    uint16_t pos = random16(LED_COUNT);
+    uint16_t pos = random16(numberOfLeds);
     // leds[pos] = CHSV(128 + random8(16), 255, buckets[5]);
     leds[pos] = ColorFromPalette(colPal, 192 + random8(RAND));
   }
 
   for (int i = 0; i < air_amp; i++) {
-    uint16_t pos = random16(LED_COUNT);
+    uint16_t pos = random16(numberOfLeds);
     // leds[pos] = CHSV(192 + random8(16), 128, buckets[6]);
     leds[pos] = ColorFromPalette(colPal, 144 + random8(RAND));
   }
 
   for (int i = 0; i < low_amp; i++) {
-    uint16_t pos = random16(LED_COUNT);
+    uint16_t pos = random16(numberOfLeds);
     leds[pos] = ColorFromPalette(colPal, 96 + random8(RAND));
     // leds[pos] = CHSV(144 + random8(16), 255, buckets[3]);
   }
@@ -733,24 +1200,20 @@ void Effects::Controller::effectMusicDancer() {
 }
 
 uint8_t freqBuckets[LED_COUNT];
-void Effects::Controller::effectFrequencies() {
+void Effects::Controller::effectFrequencies(const Frame& frame) {
   EVERY_N_SECONDS(10) { Serial.println("  - effect: display frequencies"); }
 
-  CRGBSet ledset(leds, LED_COUNT);
-
-  ledset(0, LED_COUNT) = CRGB::Black;
+  Pixels::fill(leds, numberOfLeds, CRGB::Black);
 }
 
 /**
  * eight colored dots, weaving in and out of sync with each other
  */
-void Effects::Controller::effectJuggle() {
-  EVERY_N_MILLIS(1000 / FPS) {
-    fadeToBlackBy(leds, numberOfLeds, 20);
-    byte dothue = 0;
-    for (int i = 0; i < 8; i++) {
-      leds[beatsin16(i + 7, 0, numberOfLeds - 1)] |= CHSV(dothue, 200, 255);
-      dothue += 32;
-    }
+void Effects::Controller::effectJuggle(const Frame& frame) {
+  Pixels::fadeToBlackBy(leds, numberOfLeds, 20);
+  byte dothue = 0;
+  for (int i = 0; i < 8; i++) {
+    leds[beatsin16(i + 7, 0, numberOfLeds - 1)] |= CHSV(dothue, 200, 255);
+    dothue += 32;
   }
 }
\ No newline at end of file
@@ -4,13 +4,28 @@
 #include <Arduino.h>
 #include <FastLED.h>
 
+#include <Clock.h>
+#include <Governor.h>
+#include <Hdr.h>
+#include <Layout.hpp>
 #include <LightState.hpp>
-#include <functional>
-#include <map>
+#include <Pixels.h>
+#include <Profiler.h>
+
+#include "Animation.hpp"
+#include "Palettes.hpp"
 
 namespace Effects {
 
-typedef enum { Null, None, Empty, Brightness, Color, FirmwareUpdate } Command;
+typedef enum {
+  Null,
+  None,
+  Empty,
+  Brightness,
+  Color,
+  Hue,
+  FirmwareUpdate
+} Command;
 typedef enum {
   Confetti,
   BPM,
@@ -31,62 +46,174 @@ typedef enum {
   NoEffect
 } Effect;
 
-typedef std::function<void()> EffectFunction;
-typedef std::function<void()> CmdFunction;
-typedef std::map<Command, CmdFunction> CmdQueue;
+const uint8_t COMMAND_SLOTS = Command::FirmwareUpdate + 1;
+const uint8_t MAX_LAYERS = LIGHT_MAX_LAYERS;
+static_assert(LIGHT_MAX_ZONES == Layout::MAX_SHELVES,
+              "the state has an effect for every shelf");
+const uint32_t FRAME_MICROS = 1000000 / FPS;
+
+/** Transition in ms when the state does not come with one. */
+const uint32_t DEFAULT_TRANSITION = 1000;
+
+/**
+ * Output frame from the frame scheduler. Index counts frames, time and delta
+ * are in ms. Effects get a copy where delta is the time since they last
+ * rendered.
+ */
+typedef struct Frame {
+  uint32_t index;
+  uint32_t time;
+  uint16_t delta;
+} Frame;
+
+/**
+ * What an effect keeps from one render to the next. The main effect and
+ * every slot have their own, so the same effect running in two places does
+ * not move the hue or the timers of the other. Times are in ms.
+ */
+typedef struct EffectState {
+  uint8_t startHue;
+  uint8_t confettiHue;
+  uint8_t gradientPalette;
+  uint8_t dancerPalette;
+  uint32_t paletteChanged;
+  uint32_t hueStepped;
+} EffectState;
+
+/**
+ * Effect running on one zone of the strip, with its own buffer as long as
+ * the zone.
+ */
+typedef struct ZoneSlot {
+  Effect effect;
+  uint32_t next;
+  uint32_t last;
+  EffectState state;
+  CRGB *leds;
+} ZoneSlot;
+
+/**
+ * Effect drawn over the main effect from its own buffer. Layers with opacity
+ * 0 are neither rendered nor blended.
+ */
+typedef struct LayerSlot {
+  Effect effect;
+  Pixels::Blend blend;
+  uint8_t opacity;
+  uint32_t next;
+  uint32_t last;
+  EffectState state;
+  CRGB *leds;
+} LayerSlot;
+
+/**
+ * Effect that was switched away from. It keeps rendering into its own
+ * buffer while it fades out over the new one, duration is in ms.
+ */
+typedef struct TransitionSlot {
+  Effect effect;
+  uint32_t next;
+  uint32_t last;
+  uint32_t start;
+  uint32_t duration;
+  EffectState state;
+  CRGB *leds;
+} TransitionSlot;
+
+/**
+ * Progress of one running command. There is a slot per Command so commands
+ * run side by side without sharing timing.
+ */
+typedef struct CommandSlot {
+  Animation::Tween tween;
+} CommandSlot;
 
 class Controller {
  private:
-  // typedef void (Effects::Controller::*LightCmd)();
-  // LightCmd currentCommand;
-  CmdQueue cmdQueue;
-  EffectFunction currentEffect;
+  CommandSlot commands[COMMAND_SLOTS] = {};
+  uint8_t activeCommands = 0;
   LightState::LightState state;
+  Frame frame = {};
+  uint32_t frameStart = 0;
+  uint32_t frameMicros = FRAME_MICROS;
+  Governor::Quality quality = Governor::Quality::Full;
+  uint32_t effectNext = 0;
+  uint32_t effectLast = 0;
+  EffectState effectState = {0, 0, Palettes::SunsetReal, Palettes::SunsetReal,
+                             0, 0};
+  // State of the effect rendering, the main effect's or a slot's.
+  EffectState *fx = &effectState;
+  ZoneSlot zones[Layout::MAX_SHELVES] = {};
+  uint8_t activeZones = 0;
+  LayerSlot layers[MAX_LAYERS] = {};
+  uint8_t layerCount = 0;
+  CRGB *base = nullptr;
+  TransitionSlot outgoing = {};
+  bool fading = false;
   CRGB *leds;
+#ifdef HDR_OUTPUT
+  Hdr::CRGB16 hdr[LED_COUNT] = {};
+#endif
+  uint16_t brightness16 = 0;
+  uint16_t brightnessFrom = 0;
+#ifdef HDR_OUTPUT
+  Hdr::CRGB16 colorFrom[LED_COUNT] = {};
+#else
+  CRGB colorFrom[LED_COUNT] = {};
+#endif
+  uint8_t hueFrom = 0;
+  uint8_t hueTarget = 0;
+  int8_t hueShifted = 0;
 
   uint16_t numberOfLeds = LED_COUNT;
-  uint8_t startHue = 0;
-  uint8_t confettiHue = 0;
-  uint16_t commandFrameCount = 0;
-  uint16_t commandFrames = 0;
+  // Strip index of every pixel while a zone renders, nullptr otherwise.
+  const uint16_t *zonePixels = nullptr;
 
+  void runCommand(Command cmd);
+  void finishCommand(Command cmd);
   void cmdEmpty();
   void cmdSetBrightness();
   void cmdFadeTowardColor();
+  void cmdShiftHue();
   void cmdFirmwareUpdate();
+  void setBrightness16(uint16_t brightness);
+  uint32_t getTransitionMillis();
 
-  void fadeTowardColor(CRGB *L, uint16_t N, const CRGB &bgColor,
-                       uint8_t fadeAmount);
-  CRGB fadeTowardColor(CRGB &cur, const CRGB &target, uint8_t amount);
-  void nblendU8TowardU8(uint8_t &cur, const uint8_t target, uint8_t amount);
   void addGlitter(fract8 chanceOfGlitter);
 
-  void effectGlitterRainbow();
-  void effectRainbow();
-  void effectRainbowByShelf();
-  void effectBPM();
-  void effectVUMeter();
-  void effectPride();
-  void effectColorloop();
-  void effectGradient();
-  void effectWalkingRainbow();
-  void effectMusicDancer();
-  void effectConfetti();
-  void effectSinelon();
-  void effectJuggle();
-  void effectFrequencies();
+  void runEffect(Effect effect, const Frame &frame, EffectState &s);
+  void startEffectState(EffectState &s);
+  bool isTimeFor(uint32_t &last, uint32_t period);
+  bool isEffectDue(Effect effect, uint32_t &next);
+  void runZoneEffects();
+  bool hasVisibleLayers();
+  void runLayers();
+  void startCrossfade(uint32_t duration);
+  void runOutgoing();
+
+  void effectGlitterRainbow(const Frame &frame);
+  void effectRainbow(const Frame &frame);
+  void effectRainbowByShelf(const Frame &frame);
+  void effectBPM(const Frame &frame);
+  void effectVUMeter(const Frame &frame);
+  void effectPride(const Frame &frame);
+  void effectColorloop(const Frame &frame);
+  void effectGradient(const Frame &frame);
+  void effectWalkingRainbow(const Frame &frame);
+  void effectMusicDancer(const Frame &frame);
+  void effectConfetti(const Frame &frame);
+  void effectSinelon(const Frame &frame);
+  void effectJuggle(const Frame &frame);
+  void effectFrequencies(const Frame &frame);
 
   void setInitialState();
 
  public:
   Command currentCommandType;
   Effect currentEffectType;
-  ulong commandStart = 0;
 
   Controller() {
     // this->currentCommand = &Effects::Controller::cmdEmpty;
-    this->currentEffect = []() {};
-
     this->currentCommandType = Command::None;
     this->currentEffectType = Effect::NullEffect;
   };
@@ -97,12 +224,28 @@ class Controller {
   void setCurrentCommand(Command cmd);
   void setCurrentEffect(std::string effect);
   void setCurrentEffect(Effect effect);
+  void setZoneEffect(uint8_t zone, Effect effect);
+  Effect getZoneEffect(uint8_t zone);
+  void setLayer(uint8_t index, Effect effect, Pixels::Blend blend,
+                uint8_t opacity);
+  void clearLayers();
+  Pixels::Blend getBlendFromString(std::string str);
   Effect getEffectFromString(std::string str);
+  const char *getEffectName(Effect effect);
+  bool renderFrame();
   void runCurrentCommand();
   void runCurrentEffect();
-  // void setFPS(uint8_t f);
+  uint8_t getEffectRate(Effect effect);
+  const Frame &getFrame();
+  void setFrameMicros(uint32_t micros);
+  void setQuality(Governor::Quality q);
+  Governor::Quality getQuality();
   // void setLightStateController(LightState::Controller *l);
-  void setCommandFrames(uint16_t i);
+  uint32_t getCommandStart(Command cmd);
+  uint16_t getBrightness16();
+#ifdef HDR_OUTPUT
+  const Hdr::CRGB16 *getHdrFrame() { return hdr; }
+#endif
   Effect getCurrentEffect();
   void setStartHue(float hue);
 };
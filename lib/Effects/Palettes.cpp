@@ -0,0 +1,72 @@
+#include "Palettes.hpp"
+
+DEFINE_GRADIENT_PALETTE(Paired_07_gp){
+    0,   83,  159, 190, 36,  83,  159, 190, 36,  1,   48,  106, 72,  1,
+    48,  106, 72,  100, 189, 54,  109, 100, 189, 54,  109, 3,   91,  3,
+    145, 3,   91,  3,   145, 244, 84,  71,  182, 244, 84,  71,  182, 188,
+    1,   1,   218, 188, 1,   1,   218, 249, 135, 31,  255, 249, 135, 31};
+
+DEFINE_GRADIENT_PALETTE(bhw1_05_gp){0, 1, 221, 53, 255, 73, 3, 178};
+DEFINE_GRADIENT_PALETTE(RdYlBu_gp){
+    0,   82, 0,   2,   31,  163, 6,   2,   63,  227, 39,  9,  95,  249,
+    109, 22, 127, 252, 191, 61,  127, 182, 229, 237, 159, 90, 178, 203,
+    191, 32, 108, 155, 223, 8,   45,  106, 255, 3,   8,   66};
+
+DEFINE_GRADIENT_PALETTE(Sunset_Real_gp){
+    0,  120, 0,   0,   22, 179, 22,  0,  51, 255, 104, 0, 85, 167,
+    22, 18,  135, 100, 0,  103, 198, 16, 0,  130, 255, 0, 0,  160};
+
+DEFINE_GRADIENT_PALETTE(summer_gp){
+    0,   0,   55,  25, 17,  1,   62,  25, 33,  1,   72,  25, 51,  3,   82,  25,
+    68,  8,   92,  25, 84,  14,  104, 25, 102, 23,  115, 25, 119, 35,  127, 25,
+    135, 48,  141, 25, 153, 67,  156, 25, 170, 88,  169, 25, 186, 112, 186, 25,
+    204, 142, 201, 25, 221, 175, 217, 25, 237, 210, 235, 25, 255, 255, 255, 25};
+
+DEFINE_GRADIENT_PALETTE(gr65_hult_gp){0,   247, 176, 247, 48,  255, 136, 255,
+                                      89,  220, 29,  226, 160, 7,   82,  178,
+                                      216, 1,   124, 109, 255, 1,   124, 109};
+
+namespace {
+TProgmemRGBGradientPalette_bytes gradients[Palettes::PaletteCount] = {
+    RdYlBu_gp, Paired_07_gp, bhw1_05_gp,
+    summer_gp, gr65_hult_gp, Sunset_Real_gp};
+
+CRGBPalette256 bank[Palettes::PaletteCount];
+CRGBPalette16 rainbowPalette;
+CRGBPalette16 partyPalette;
+bool expanded = false;
+}  // namespace
+
+/**
+ * Expands all palettes. Safe to call more than once.
+ */
+void Palettes::setup() {
+  if (expanded)
+    return;
+
+  for (uint8_t i = 0; i < PaletteCount; i++) {
+    bank[i] = gradients[i];
+  }
+  rainbowPalette = Rainbow_gp;
+  partyPalette = PartyColors_p;
+  expanded = true;
+}
+
+const CRGBPalette256& Palettes::get(uint8_t index) {
+  return bank[index % PaletteCount];
+}
+
+/**
+ * Index of the palette after index, wrapping around.
+ */
+uint8_t Palettes::next(uint8_t index) {
+  return (index + 1) % PaletteCount;
+}
+
+const CRGBPalette16& Palettes::rainbow() {
+  return rainbowPalette;
+}
+
+const CRGBPalette16& Palettes::party() {
+  return partyPalette;
+}
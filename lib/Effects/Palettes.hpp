@@ -0,0 +1,36 @@
+/**
+ * Palette bank for the effects.
+ *
+ * The gradient palettes are expanded to 256 entries once, by setup(), into
+ * static storage. Effects look them up by index instead of building their
+ * own copies every frame.
+ */
+#ifndef Palettes_h
+#define Palettes_h
+
+#include <Arduino.h>
+#include <FastLED.h>
+
+namespace Palettes {
+
+typedef enum {
+  RdYlBu,
+  Paired07,
+  Bhw105,
+  Summer,
+  Gr65Hult,
+  SunsetReal,
+  PaletteCount
+} Palette;
+
+void setup();
+
+const CRGBPalette256 &get(uint8_t index);
+uint8_t next(uint8_t index);
+
+const CRGBPalette16 &rainbow();
+const CRGBPalette16 &party();
+
+}  // namespace Palettes
+
+#endif  // Palettes_h
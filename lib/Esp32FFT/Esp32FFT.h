@@ -2,19 +2,34 @@
 #define ESP32FFT_H
 
 #include <Arduino.h>
+#include <Agc.h>
+#include <AudioCapture.h>
+#include <Bands.h>
 #include <FastLED.h>
-#include <arduinoFFT.h>
-#include <driver/adc.h>
+#include <RealFFT.h>
 
 #include <array>
 
 #define SAMPLING_FREQUENCY 40000
-#define FFT_SAMPLES 1024
+#define FFT_SAMPLES REALFFT_SIZE
+// Samples between windows, a new spectrum every 6.4 ms.
+#ifndef FFT_HOP
+#define FFT_HOP 256
+#endif
+#define FFT_HOP_MICROS (FFT_HOP * 1000000ull / SAMPLING_FREQUENCY)
+#ifndef FFT_BUCKETS
 #define FFT_BUCKETS 6
-#define FFT_LOW_CUTOFF 32000
-#define FFT_HIGH_CUTOFF 320000
-#define AVG_MAX 200
-#define AVG_BASE 2047
+#endif
+#ifndef FFT_BAND_SPACING
+#define FFT_BAND_SPACING Bands::defaultSpacing(FFT_BUCKETS)
+#endif
+// Smallest rise over the noise floor that reaches full scale, in magnitude.
+#ifndef FFT_MIN_SPAN
+#define FFT_MIN_SPAN 16000
+#endif
+
+static_assert(FFT_BUCKETS >= BANDS_MIN && FFT_BUCKETS <= BANDS_MAX,
+              "FFT_BUCKETS must be between BANDS_MIN and BANDS_MAX");
 
 class Esp32FFT {
  public:
@@ -24,231 +39,99 @@ class Esp32FFT {
 #ifdef DEBUG
     Serial.println("  - Running Esp32FFT setup.");
 #endif
-    analogReadResolution(12);
-    analogSetCycles(6);
-    analogSetSamples(1);
-    analogSetAttenuation(ADC_11db);
+    capture.begin(FFT_INPUT_PIN, SAMPLING_FREQUENCY);
+    bands.build(FFT_BAND_SPACING, FFT_BUCKETS, SAMPLING_FREQUENCY,
+                FFT_SAMPLES);
+
+    Agc::Settings settings = Agc::DEFAULTS;
+    settings.minSpan = FFT_MIN_SPAN;
+    agc.begin(FFT_BUCKETS, 1, settings);
   }
 
   /**
    * Returns the number of frequency buckets used
    */
-  const uint8_t getBucketCount() { return FFT_BUCKETS; }
+  uint8_t getBucketCount() { return FFT_BUCKETS; }
 
+  /**
+   * Buckets of the newest analysed window. Windows overlap and start every
+   * FFT_HOP samples; a new one is only analysed once the capture has moved
+   * past the next hop, until then every call gets the cached result.
+   */
   std::array<uint8_t, FFT_BUCKETS> getSampleSet() {
-    fftComputeSampleset();
-    fftFillBuckets();
+    if (fftComputeSampleset())
+      fftFillBuckets();
 
     return buckets;
   }
 
- private:
-  double vReal[FFT_SAMPLES];
-  double vImag[FFT_SAMPLES];
-
-  std::array<uint8_t, FFT_BUCKETS> buckets;
-  std::array<uint16_t, AVG_MAX> AVG_SAMP;
-
-  uint32_t AVG_CTR = 0;
-
-  uint32_t newtime = 0;
-  uint32_t oldtime = 0;
+  /** Buckets last returned by getSampleSet(), without taking a new one. */
+  const std::array<uint8_t, FFT_BUCKETS>& getBuckets() { return buckets; }
 
-  uint32_t sampling_period = round(1000000 * (1.0 / SAMPLING_FREQUENCY));
+  /** Number of windows analysed so far. */
+  uint32_t getAnalyses() { return analyses; }
 
-  double AMP_FACTOR = 1.00;
+ private:
+  AudioCapture::Capture capture;
+  uint16_t window[FFT_SAMPLES] = {};
+  float samples[FFT_SAMPLES];
+  float magnitudes[FFT_SAMPLES / 2 + 1];
+  float levels[FFT_BUCKETS];
+  Bands::Mapper bands;
+  Agc::Controller agc;
 
-  arduinoFFT fft = arduinoFFT();
+  std::array<uint8_t, FFT_BUCKETS> buckets = {};
 
-  uint32_t sampleDelay() {
-    newtime = micros() - oldtime;
-    oldtime = newtime;
+  // Capture index one past the newest analysed window, and the hops since
+  // the one before.
+  uint32_t windowEnd = 0;
+  uint32_t windowHops = 0;
+  uint32_t analyses = 0;
 
-    return (newtime + sampling_period);
-  }
+  RealFFT::Transform fft;
 
-  void fftComputeSampleset() {
-    // unsigned long start = micros();
-    uint16_t sample;
+  /**
+   * Takes the newest window ending on a hop from the capture ring and
+   * transforms it. After a stall the hops in between are skipped, but
+   * counted for the gain control. Returns false when there is no new window
+   * yet.
+   */
+  bool fftComputeSampleset() {
+    float mean = 0;
+
+    capture.update();
+    uint32_t end = capture.getRing().getWritten();
+    end -= end % FFT_HOP;
+    if (end == windowEnd ||
+        !capture.getRing().read(end, window, FFT_SAMPLES))
+      return false;
+    windowHops = (end - windowEnd) / FFT_HOP;
+    windowEnd = end;
+    analyses++;
 
     for (int i = 0; i < FFT_SAMPLES; i++) {
-      sample = analogRead(FFT_INPUT_PIN);
-
-      EVERY_N_MILLIS(200) {
-        AVG_SAMP[(AVG_CTR % AVG_MAX)] = sample;
-        AVG_CTR++;
-      }
-
-      int adjusted = (int)(sample * AMP_FACTOR);
-      if (adjusted < 0) adjusted = 0;
-      if (adjusted > 4095) adjusted = 4095;
-
-      vReal[i] = adjusted;
-      vImag[i] = 0;
+      samples[i] = window[i];
+      mean += window[i];
     }
-    // unsigned long doneSamples = micros();
-
-    fft.Windowing(vReal, FFT_SAMPLES, FFT_WIN_TYP_HAMMING, FFT_FORWARD);
-    fft.Compute(vReal, vImag, FFT_SAMPLES, FFT_FORWARD);
-    fft.ComplexToMagnitude(vReal, vImag, FFT_SAMPLES);
-    // unsigned long doneCompute = micros();
 
-    EVERY_N_MILLIS(1000) {
-      // Calculate average amplitude every 5 seconds.
-      uint32_t avg_sum = 0;
-      for (int i = 0; i < AVG_MAX; i++) {
-        avg_sum += AVG_SAMP[i];
-      }
-
-      double avg = (AVG_CTR > 200) ? avg_sum / (double)AVG_MAX
-                                   : avg_sum / (double)AVG_CTR;
-      AMP_FACTOR = (avg > 0) ? AVG_BASE / avg : 0;
-
-#ifdef DEBUG
-      Serial.printf("Average: raw: %6i\t avg: %8.2f\tfac: %8.2f\tadj: %6i\n",
-                    sample, avg, AMP_FACTOR, (int)(avg * AMP_FACTOR));
-#endif
+    // Without the bias of the input the lowest bins only hold the signal.
+    mean /= FFT_SAMPLES;
+    for (int i = 0; i < FFT_SAMPLES; i++) {
+      samples[i] -= mean;
     }
+
+    fft.magnitudes(samples, magnitudes);
+    return true;
   }
 
+  /**
+   * Maps the spectrum onto the bands and levels them to 0 - 255, over the
+   * time since the last window, however long nobody asked for one.
+   */
   void fftFillBuckets() {
-    int next = 0;
-    int prev = 0;
-    int curr = 0;
-
-    // ====================================================================
-    // 0: Bass: 60 - 250 Hz
-    curr = (int)vReal[2];
-    next = (int)vReal[3];
-
-    if (next > (curr * 2.19)) curr = 0;
-
-    //  Serial.printf("%6i\t%6i\t%6i\t", prev, curr, next);
-
-    curr -= FFT_LOW_CUTOFF;
-    if (curr < 0) curr = 0;
-
-    curr = constrain(curr, 0, FFT_HIGH_CUTOFF);
-    curr = map(curr, 0, FFT_HIGH_CUTOFF, 0, 255);
-
-    buckets[0] = (uint8_t)curr;
-
-    // ====================================================================
-    // 1: Low midrange: 250 - 500 Hz
-    curr = 0;
-    next = 0;
-    prev = (int)vReal[2];
-
-    for (int i = 3; i < 6; i++) {
-      curr = max((int)vReal[i], curr);
-    }
-
-    if (prev > (curr * 0.47)) curr = 0;
-
-    //   Serial.printf("%6i\t%6i\t%6i\t", prev, curr, next);
-    curr -= FFT_LOW_CUTOFF;
-    if (curr < 0) curr = 0;
-
-    curr = constrain(curr, 0, FFT_HIGH_CUTOFF);
-    curr = map(curr, 0, FFT_HIGH_CUTOFF, 0, 255);
-    buckets[1] = (uint8_t)curr;
-
-    // ====================================================================
-    // 2: Midrange: 500 - 2 kHz
-    curr = 0;
-
-    for (int i = 6; i < 24; i++) {
-      curr = (vReal[i] > curr) ? vReal[i] : curr;
-    }
-
-    // Serial.printf("%6i\t%6i\t%6i\t", prev, curr, next);
-    curr -= FFT_LOW_CUTOFF;
-    if (curr < 0) curr = 0;
-
-    curr = constrain(curr, 0, FFT_HIGH_CUTOFF);
-    curr = map(curr, 0, FFT_HIGH_CUTOFF, 0, 255);
-
-    buckets[2] = (uint8_t)curr;
-
-    // ====================================================================
-    // 4: Upper Midrange: 2 - 4 kHz
-    curr = 0;
-
-    for (int i = 24; i < 48; i++) {
-      curr = max((int)vReal[i], curr);
-    }
-
-    //  Serial.printf("%6i\t%6i\t%6i\t", prev, curr, next);
-    curr -= FFT_LOW_CUTOFF;
-    if (curr < 0) curr = 0;
-
-    curr = constrain(curr, 0, FFT_HIGH_CUTOFF);
-    curr = map(curr, 0, FFT_HIGH_CUTOFF, 0, 255);
-
-    buckets[3] = (uint8_t)curr;
-
-    // ====================================================================
-    //   // 5: precence: 4 - 6 kHz
-    curr = 0;
-
-    for (int i = 48; i < 72; i++) {
-      curr = max((int)vReal[i], curr);
-    }
-
-    //   Serial.printf("%6i\t%6i\t%6i\t", prev, curr, next);
-    curr -= FFT_LOW_CUTOFF;
-    if (curr < 0) curr = 0;
-
-    curr = constrain(curr, 0, FFT_HIGH_CUTOFF);
-    curr = map(curr, 0, FFT_HIGH_CUTOFF, 0, 255);
-
-    buckets[4] = (uint8_t)curr;
-
-    // ====================================================================
-    // 6: Brilliance: 6 - 20 kHz kHz
-    curr = 0;
-
-    for (int i = 71; i < 240; i++) {
-      curr = max((int)vReal[i], curr);
-    }
-
-    // Serial.printf("%6i\t%6i\t%6i\t", prev, curr, next);
-    curr -= FFT_LOW_CUTOFF;
-    if (curr < 0) curr = 0;
-
-    curr = constrain(curr, 0, FFT_HIGH_CUTOFF);
-    curr = map(curr, 0, FFT_HIGH_CUTOFF, 0, 255);
-
-    buckets[5] = (uint8_t)curr;
-
-    // ====================================================================
-    // Debug printing:
-    // ====================================================================
-    // int FROM = 70;
-    // int TO = 175;
-    // int MOD = 2;
-    //
-    //   for (int i = FROM; i < TO; i++) {
-    //     if (i % MOD == 0) Serial.printf("%6i\t", (int)vReal[i]);
-    //   }
-    //   Serial.println();
-    //
-    //   EVERY_N_MILLIS(1000) {
-    //     Serial.println();
-    //     Serial.printf("%6s\t%6s\t%6s\t", "prev", "curr", "next");
-    //
-    //     for (int i = FROM; i < TO; i++) {
-    //       if (i % MOD == 0) Serial.printf("%6i\t", i);
-    //     }
-    //     Serial.println();
-    //     for (int i = FROM; i < (TO + 3); i++) {
-    //       if (i % MOD == 0) Serial.printf("------\t");
-    //     }
-    //     Serial.println();
-    //   }
+    bands.map(magnitudes, levels);
+    agc.update(levels, buckets.data(), windowHops * FFT_HOP_MICROS);
   }
-
-  void fftFillBucketsSimple();
 };
 
 #endif  // ESP32FFT_H
\ No newline at end of file
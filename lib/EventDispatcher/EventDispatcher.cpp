@@ -64,6 +64,11 @@ EventDispatcher& EventDispatcher::onFirmwareUpdate(
   return *this;
 };
 
+EventDispatcher& EventDispatcher::onQuery(QueryHandler callback) {
+  _queryHandlers.push_back(callback);
+  return *this;
+}
+
 EventDispatcher& EventDispatcher::enableVerboseOutput(bool v) {
   VERBOSE = v;
   return *this;
@@ -175,6 +180,10 @@ void EventDispatcher::handleUpdate(std::string topic, std::string message) {
 
 void EventDispatcher::handleQuery(std::string topic, std::string message) {
   Serial.printf("[hub] Handle Query: %s\n", message.c_str());
+
+  for (auto callback : _queryHandlers) {
+    callback(message);
+  }
 }
 
 void EventDispatcher::handleState(std::string topic, std::string message) {
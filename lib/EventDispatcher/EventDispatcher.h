@@ -27,6 +27,7 @@ typedef std::map<std::string, std::function<void(std::string, std::string)>>
 
 typedef std::function<void(LightState::LightState)> StateChangeHandler;
 typedef std::function<void()> FirmwareUpdateHandler;
+typedef std::function<void(std::string)> QueryHandler;
 
 class EventDispatcher {
  public:
@@ -45,7 +46,7 @@ class EventDispatcher {
 
   EventDispatcher& onStateChange(StateChangeHandler callback);
   EventDispatcher& onFirmwareUpdate(FirmwareUpdateHandler callback);
-  EventDispatcher& onQuery();
+  EventDispatcher& onQuery(QueryHandler callback);
   EventDispatcher& onError();
   EventDispatcher& onDisconnect();
 
@@ -62,6 +63,7 @@ class EventDispatcher {
   TopicHandlerMap handlers;
   std::vector<StateChangeHandler> _stateHandlers;
   std::vector<FirmwareUpdateHandler> _updateHandlers;
+  std::vector<QueryHandler> _queryHandlers;
   LedshelfConfig config;
   LightState::Controller* lightState;
 
@@ -0,0 +1,94 @@
+#include "FrameTap.h"
+
+#include <Clock.h>
+#include <string.h>
+
+#if defined(ESP32)
+#include <lwip/sockets.h>
+#elif defined(NATIVE)
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+// Both targets are little endian, so the header is sent as it is in memory.
+static uint8_t packet[FrameTap::PACKET_SIZE];
+
+bool FrameTap::Tap::begin(const char* host, uint16_t p, uint8_t d) {
+#ifdef TAP_SUPPORTED
+  stop();
+
+  address = inet_addr(host);
+  if (address == INADDR_NONE)
+    return false;
+
+  sock = socket(AF_INET, SOCK_DGRAM, 0);
+  if (sock < 0)
+    return false;
+  fcntl(sock, F_SETFL, fcntl(sock, F_GETFL, 0) | O_NONBLOCK);
+
+  port = p;
+  divider = d ? d : 1;
+  skipped = 0;
+
+#ifdef DEBUG
+  Serial.printf("[tap] sending every %i. frame to %s:%i.\n", divider, host,
+                port);
+#endif
+  return true;
+#else
+  return false;
+#endif
+}
+
+void FrameTap::Tap::stop() {
+#ifdef TAP_SUPPORTED
+  if (sock < 0)
+    return;
+
+  close(sock);
+  sock = -1;
+#endif
+}
+
+void FrameTap::Tap::frame(const CRGB* leds, uint16_t n, uint8_t brightness) {
+#ifdef TAP_SUPPORTED
+  if (sock < 0)
+    return;
+  if (++skipped < divider)
+    return;
+  skipped = 0;
+
+  struct sockaddr_in destination = {};
+  destination.sin_family = AF_INET;
+  destination.sin_port = htons(port);
+  destination.sin_addr.s_addr = address;
+
+  Header* header = reinterpret_cast<Header*>(packet);
+  memcpy(header->magic, TAP_MAGIC, sizeof(header->magic));
+  header->version = TAP_VERSION;
+  header->brightness = brightness;
+  header->count = n;
+  header->sequence = sequence++;
+  header->micros = Clock::micros();
+
+  for (uint16_t offset = 0; offset < n; offset += TAP_CHUNK_LEDS) {
+    uint16_t length = n - offset;
+    if (length > TAP_CHUNK_LEDS)
+      length = TAP_CHUNK_LEDS;
+    header->offset = offset;
+    header->length = length;
+    memcpy(packet + sizeof(Header), leds + offset, length * sizeof(CRGB));
+
+    size_t size = sizeof(Header) + length * sizeof(CRGB);
+    if (sendto(sock, packet, size, MSG_DONTWAIT,
+               reinterpret_cast<struct sockaddr*>(&destination),
+               sizeof(destination)) != static_cast<ssize_t>(size)) {
+      failedFrames++;
+      return;
+    }
+  }
+  sentFrames++;
+#endif
+}
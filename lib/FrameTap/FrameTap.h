@@ -0,0 +1,77 @@
+/**
+ * Sends rendered frames over UDP so they can be watched or recorded away
+ * from the shelves.
+ *
+ * Every divider-th frame goes out as one or more datagrams, each a Header
+ * followed by up to TAP_CHUNK_LEDS pixels as r, g, b bytes. All datagrams of
+ * a frame share its sequence number and time. The socket never blocks: when
+ * the network stack has no room the frame is counted as failed and dropped.
+ *
+ * Packets are built in one static buffer, nothing is allocated per frame.
+ * Only ESP32 and the native build have a network stack, elsewhere begin()
+ * returns false.
+ */
+#ifndef FRAMETAP_H
+#define FRAMETAP_H
+
+#include <Arduino.h>
+#include <FastLED.h>
+
+#if defined(ESP32) || defined(NATIVE)
+#define TAP_SUPPORTED 1
+#endif
+
+#define TAP_MAGIC "LTAP"
+#define TAP_VERSION 1
+
+// Pixels per datagram, keeps it under a 1500 byte ethernet MTU.
+#define TAP_CHUNK_LEDS 480
+
+namespace FrameTap {
+
+/** Multi byte fields are little endian. */
+typedef struct __attribute__((packed)) Header {
+  char magic[4];
+  uint8_t version;
+  uint8_t brightness;
+  uint16_t count;  // leds in the whole frame
+  uint16_t offset;  // of the first led in this datagram
+  uint16_t length;  // leds in this datagram
+  uint32_t sequence;
+  uint32_t micros;
+} Header;
+
+const uint16_t PACKET_SIZE = sizeof(Header) + TAP_CHUNK_LEDS * sizeof(CRGB);
+
+class Tap {
+ private:
+  int sock = -1;
+  uint32_t address = 0;
+  uint16_t port = 0;
+  uint8_t divider = 1;
+  uint8_t skipped = 0;
+  uint32_t sequence = 0;
+  uint32_t sentFrames = 0;
+  uint32_t failedFrames = 0;
+
+ public:
+  ~Tap() { stop(); }
+
+  /**
+   * Starts sending to host (dotted IPv4) and port, every divider-th frame.
+   * Returns false for a bad address or when there is no network stack.
+   */
+  bool begin(const char* host, uint16_t port, uint8_t divider);
+  void stop();
+  bool isRunning() { return sock >= 0; }
+
+  /** Hands the tap a rendered frame, sends it if it is its turn. */
+  void frame(const CRGB* leds, uint16_t n, uint8_t brightness);
+
+  uint32_t getSentFrames() { return sentFrames; }
+  uint32_t getFailedFrames() { return failedFrames; }
+};
+
+}  // namespace FrameTap
+
+#endif  // FRAMETAP_H
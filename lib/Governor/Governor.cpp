@@ -0,0 +1,139 @@
+#include "Governor.h"
+
+void Governor::Controller::recordNetwork(uint32_t micros) {
+  if (micros > network)
+    network = micros;
+}
+
+bool Governor::Controller::recordFrame(uint32_t micros, bool dropped) {
+  uint32_t cost = micros + network;
+  network = 0;
+
+  windowFrames++;
+  windowMicros += cost;
+  if (cost > windowMax)
+    windowMax = cost;
+  if (dropped)
+    telemetry.dropped++;
+  if (cost > getFrameMicros() || dropped) {
+    windowOverruns++;
+    telemetry.overruns++;
+  }
+
+  uint32_t length = telemetry.fps / 2;
+  if (windowFrames < ((length < 4) ? 4 : length))
+    return false;
+
+  return endWindow();
+}
+
+/**
+ * Judges the window that just filled. Overload steps down right away,
+ * stepping up waits for enough quiet windows in a row. A step up that is
+ * overloaded in its first window is taken back and the next one waits twice
+ * as long, with no limit, unless the load has clearly dropped since.
+ */
+bool Governor::Controller::endWindow() {
+  uint32_t period = getFrameMicros();
+  uint64_t load = windowMicros * 100 / (windowFrames * period);
+  bool overloaded =
+      load > DOWN_LOAD || windowOverruns * DOWN_OVERRUNS > windowFrames;
+
+  telemetry.load = (load > 255) ? 255 : load;
+  telemetry.maxMicros = windowMax;
+  windowFrames = 0;
+  windowOverruns = 0;
+  windowMicros = 0;
+  windowMax = 0;
+
+  if (overloaded) {
+    quietWindows = 0;
+    if (steppedUp && upWindows < UINT32_MAX / 2)
+      upWindows *= 2;
+    steppedUp = false;
+
+    if (level == LEVEL_COUNT - 1)
+      return false;
+
+    setLevel(level + 1);
+    telemetry.stepsDown++;
+#ifdef DEBUG
+    Serial.printf("[governor] load %u%%, down to %u fps, %s quality.\n",
+                  (uint32_t)load, telemetry.fps,
+                  getQualityName(telemetry.quality));
+#endif
+    return true;
+  }
+
+  if (steppedUp) {
+    steppedUp = false;
+    upWindows = UP_WINDOWS;
+  }
+
+  if (level == 0)
+    return false;
+
+  // The same work at the next level up has a shorter period.
+  uint32_t projected = load * LEVELS[level - 1].percent / LEVELS[level].percent;
+  if (upWindows > UP_WINDOWS && projected * 100 < upLoad * UP_RETRY_LOAD)
+    upWindows = UP_WINDOWS;
+
+  quietWindows = (projected < UP_LOAD) ? quietWindows + 1 : 0;
+  if (quietWindows < upWindows)
+    return false;
+
+  quietWindows = 0;
+  steppedUp = true;
+  upLoad = projected;
+  setLevel(level - 1);
+  telemetry.stepsUp++;
+#ifdef DEBUG
+  Serial.printf("[governor] load %u%%, up to %u fps, %s quality.\n",
+                (uint32_t)load, telemetry.fps,
+                getQualityName(telemetry.quality));
+#endif
+  return true;
+}
+
+void Governor::Controller::setLevel(uint8_t l) {
+  level = l;
+  telemetry.level = l;
+  telemetry.fps = FPS * LEVELS[l].percent / 100;
+  telemetry.quality = LEVELS[l].quality;
+}
+
+uint32_t Governor::Controller::getFrameMicros() {
+  return 100000000 / (FPS * LEVELS[level].percent);
+}
+
+Governor::Quality Governor::Controller::getQuality() {
+  return LEVELS[level].quality;
+}
+
+const Governor::Telemetry& Governor::Controller::getTelemetry() {
+  return telemetry;
+}
+
+const char* Governor::Controller::getQualityName(Quality q) {
+  switch (q) {
+    case Quality::Full:
+      return "full";
+    case Quality::Reduced:
+      return "reduced";
+    case Quality::Minimal:
+      return "minimal";
+    default:
+      return "";
+  }
+}
+
+int Governor::Controller::describe(char* buffer, size_t size) {
+  return snprintf(buffer, size,
+                  "{\"governor\":{\"fps\":%u,\"quality\":\"%s\",\"level\":%u,"
+                  "\"load\":%u,\"max_us\":%u,\"overruns\":%u,\"dropped\":%u,"
+                  "\"down\":%u,\"up\":%u}}",
+                  telemetry.fps, getQualityName(telemetry.quality),
+                  telemetry.level, telemetry.load, telemetry.maxMicros,
+                  telemetry.overruns, telemetry.dropped, telemetry.stepsDown,
+                  telemetry.stepsUp);
+}
@@ -0,0 +1,106 @@
+/**
+ * Frame rate governor.
+ *
+ * Keeps the loop inside its frame budget by stepping down a fixed ladder of
+ * levels when frames cost more than the period they have, and back up when
+ * there is room again. A level is a frame rate, as a share of FPS, and the
+ * quality effects should render at. The rate drops first, quality only goes
+ * down once running at half of FPS is not enough.
+ *
+ * Frame cost is what the loop spends on one frame: rendering, showing it and
+ * the longest network pass since the previous frame. A frame the output had
+ * to drop, because it was still busy with an earlier one on another core,
+ * counts as overrunning however little it cost the loop. It is judged over
+ * windows of half a second. The governor only does the bookkeeping, the
+ * caller measures the time and applies the level.
+ */
+#ifndef GOVERNOR_H
+#define GOVERNOR_H
+
+#include <Arduino.h>
+
+namespace Governor {
+
+typedef enum { Full, Reduced, Minimal } Quality;
+
+typedef struct Level {
+  uint8_t percent;  // of FPS
+  Quality quality;
+} Level;
+
+const Level LEVELS[] = {{100, Quality::Full},   {75, Quality::Full},
+                        {50, Quality::Full},    {50, Quality::Reduced},
+                        {33, Quality::Reduced}, {25, Quality::Minimal}};
+const uint8_t LEVEL_COUNT = sizeof(LEVELS) / sizeof(LEVELS[0]);
+
+/** Average load in percent of the period above which a level steps down. */
+const uint8_t DOWN_LOAD = 90;
+
+/** A window with more overrunning frames than 1 / DOWN_OVERRUNS steps down. */
+const uint8_t DOWN_OVERRUNS = 4;
+
+/** Load the next level up would have, in percent, to step up to it. */
+const uint8_t UP_LOAD = 70;
+
+/**
+ * Quiet windows needed before stepping up, doubled each time that fails for
+ * as long as the load stays where it was. Back to UP_WINDOWS once the step
+ * holds or the load drops to UP_RETRY_LOAD percent of what it was when the
+ * step failed.
+ */
+const uint8_t UP_WINDOWS = 4;
+const uint8_t UP_RETRY_LOAD = 75;
+
+typedef struct Telemetry {
+  uint8_t level;
+  uint16_t fps;
+  Quality quality;
+  uint8_t load;  // average of the last window, percent of the period
+  uint32_t maxMicros;
+  uint32_t overruns;
+  uint32_t dropped;
+  uint32_t stepsDown;
+  uint32_t stepsUp;
+} Telemetry;
+
+class Controller {
+ private:
+  uint8_t level = 0;
+  uint32_t network = 0;
+  uint32_t windowFrames = 0;
+  uint32_t windowOverruns = 0;
+  uint64_t windowMicros = 0;
+  uint32_t windowMax = 0;
+  uint32_t quietWindows = 0;
+  uint32_t upWindows = UP_WINDOWS;
+  uint32_t upLoad = 0;
+  bool steppedUp = false;
+  Telemetry telemetry = {};
+
+  bool endWindow();
+  void setLevel(uint8_t l);
+
+ public:
+  Controller() { setLevel(0); }
+
+  /** Time of one network pass, the longest since the last frame counts. */
+  void recordNetwork(uint32_t micros);
+
+  /**
+   * Time spent rendering and showing a frame, and whether the output
+   * dropped it. Returns true when it closed a window that changed the level.
+   */
+  bool recordFrame(uint32_t micros, bool dropped = false);
+
+  uint32_t getFrameMicros();
+  Quality getQuality();
+  const Telemetry& getTelemetry();
+  const char* getQualityName(Quality q);
+
+  /** Telemetry as a JSON object. */
+  int describe(char* buffer, size_t size);
+};
+
+}  // namespace Governor
+
+#endif  // GOVERNOR_H
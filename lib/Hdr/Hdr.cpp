@@ -0,0 +1,63 @@
+#include "Hdr.h"
+
+#include <string.h>
+
+Hdr::CRGB16 Hdr::widen(const CRGB& color) {
+  return {widen(color.r), widen(color.g), widen(color.b)};
+}
+
+void Hdr::widen(const CRGB* in, CRGB16* out, uint16_t n) {
+  const uint8_t* src = in[0].raw;
+  uint16_t* dst = &out[0].r;
+
+  for (uint16_t i = 0; i < n * 3; i++) {
+    dst[i] = src[i] * 257;
+  }
+}
+
+void Hdr::narrow(const CRGB16* in, CRGB* out, uint16_t n) {
+  const uint16_t* src = &in[0].r;
+  uint8_t* dst = out[0].raw;
+
+  for (uint16_t i = 0; i < n * 3; i++) {
+    dst[i] = src[i] >> 8;
+  }
+}
+
+uint8_t Hdr::splitBrightness(uint16_t brightness, uint16_t& pixelScale) {
+#if defined(LED_CLOCK) && defined(FASTLED_USE_GLOBAL_BRIGHTNESS)
+  // Smallest show scale that still reaches brightness, the pixels make up
+  // the rest.
+  uint8_t show = (brightness + 256) / 257;
+  pixelScale = show ? ((uint32_t)brightness * FULL) / (show * 257) : 0;
+  return show;
+#else
+  pixelScale = brightness;
+  return brightness ? 255 : 0;
+#endif
+}
+
+/**
+ * The output kernel. One multiply, add and shift per channel; the low byte
+ * that is cut off is kept in residual and added back next frame.
+ */
+void Hdr::Dither::render(const CRGB16* in, CRGB* out, uint16_t n,
+                         uint16_t scale) {
+  const uint16_t* src = &in[0].r;
+  uint8_t* dst = out[0].raw;
+  // 8.8 result, so FULL maps to 255.0 rather than 255.996.
+  uint32_t s = ((uint32_t)(scale + 1) * 65281) >> 16;
+
+  for (uint16_t i = 0; i < n * 3; i++) {
+    uint32_t v = ((src[i] * s) >> 16) + residual[i];
+    if (v > FULL)
+      v = FULL;
+
+    dst[i] = v >> 8;
+    residual[i] = v & 0xFF;
+  }
+}
+
+void Hdr::Dither::reset() {
+  memset(residual, 0, sizeof(residual));
+}
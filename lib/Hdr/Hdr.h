@@ -0,0 +1,66 @@
+/**
+ * 16 bit per channel frames and the stage that turns them into 8 bit output.
+ *
+ * Transitions that step visibly at 8 bits (slow color fades, low brightness)
+ * run on CRGB16 pixels. Dither::render() applies a 16 bit brightness and
+ * converts to CRGB with temporal error diffusion: the part of each channel
+ * that does not fit in 8 bits is carried to the next frame, so over a few
+ * frames the strip averages to the 16 bit value.
+ *
+ * Only the brightness and the color fade are worked out at 16 bits. Effects
+ * still render 8 bit CRGB that is widened afterwards, so their gradients
+ * gain nothing below 8 bits.
+ */
+#ifndef HDR_H
+#define HDR_H
+
+#include <Arduino.h>
+#include <FastLED.h>
+
+namespace Hdr {
+
+typedef struct CRGB16 {
+  uint16_t r;
+  uint16_t g;
+  uint16_t b;
+} CRGB16;
+
+const uint16_t FULL = 0xFFFF;
+
+inline uint16_t widen(uint8_t value) {
+  return value * 257;
+}
+
+CRGB16 widen(const CRGB& color);
+void widen(const CRGB* in, CRGB16* out, uint16_t n);
+void narrow(const CRGB16* in, CRGB* out, uint16_t n);
+
+/**
+ * Splits a 16 bit brightness into the 8 bit scale for FastLED.show() and the
+ * 16 bit scale to apply to the pixels. With a clocked strip (SK9822) and
+ * FASTLED_USE_GLOBAL_BRIGHTNESS the show scale goes into the 5 bit global
+ * brightness field, so it is kept as low as possible. Otherwise all of it is
+ * applied to the pixels.
+ */
+uint8_t splitBrightness(uint16_t brightness, uint16_t& pixelScale);
+
+class Dither {
+ public:
+  /**
+   * Scales in by scale (0-FULL) and writes the dithered result to out,
+   * every frame. A still frame keeps changing while any channel carries a
+   * residual, that is the precision below 8 bits. Once every channel is a
+   * whole 8 bit value out stays the same and the output skips showing it.
+   */
+  void render(const CRGB16* in, CRGB* out, uint16_t n, uint16_t scale);
+
+  /** Clears the carried error. */
+  void reset();
+
+ private:
+  uint8_t residual[LED_COUNT * 3] = {};
+};
+
+}  // namespace Hdr
+
+#endif  // HDR_H
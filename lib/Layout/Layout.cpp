@@ -0,0 +1,122 @@
+#include "Layout.hpp"
+
+#include <string.h>
+
+namespace {
+
+/**
+ * The strip of every build, segments in strip order. Shelves count from the
+ * start of the strip. Add a table here for a new strip and pick it with its
+ * flag in platformio.ini.
+ */
+#if defined(LAYOUT_DEV)
+// 64 leds along the front of the shelf, the last 15 back along the rear.
+constexpr Layout::Segment SEGMENTS[] = {
+    {0, 0, 64, false},
+    {0, 64, 15, true}};
+#elif defined(LAYOUT_EDITH)
+// Out and back along the first shelf, the strip ends 12 leds into the
+// second.
+constexpr Layout::Segment SEGMENTS[] = {
+    {0, 0, 64, false},
+    {0, 64, 64, true},
+    {1, 128, 12, false}};
+#elif defined(LAYOUT_MARTHA)
+// Out and back along three shelves.
+constexpr Layout::Segment SEGMENTS[] = {
+    {0, 0, 64, false},   {0, 64, 64, true},   {1, 128, 64, false},
+    {1, 192, 64, true},  {2, 256, 64, false}, {2, 320, 64, true}};
+#elif defined(LAYOUT_BENCH_2000)
+// Benchmark only, out and back along eight 125 led shelves.
+constexpr Layout::Segment SEGMENTS[] = {
+    {0, 0, 125, false},     {0, 125, 125, true},   {1, 250, 125, false},
+    {1, 375, 125, true},    {2, 500, 125, false},  {2, 625, 125, true},
+    {3, 750, 125, false},   {3, 875, 125, true},   {4, 1000, 125, false},
+    {4, 1125, 125, true},   {5, 1250, 125, false}, {5, 1375, 125, true},
+    {6, 1500, 125, false},  {6, 1625, 125, true},  {7, 1750, 125, false},
+    {7, 1875, 125, true}};
+#else
+#error "No strip layout, build with one of the LAYOUT_<name> flags"
+#endif
+
+const uint8_t SEGMENT_COUNT = sizeof(SEGMENTS) / sizeof(SEGMENTS[0]);
+
+/**
+ * Whether the segments from s on start at led, one after the other, fit
+ * the tables and end at LED_COUNT.
+ */
+constexpr bool isComplete(uint8_t s, uint16_t led) {
+  return (s == SEGMENT_COUNT)
+             ? led == LED_COUNT
+             : SEGMENTS[s].start == led &&
+                   SEGMENTS[s].shelf < Layout::MAX_SHELVES &&
+                   SEGMENTS[s].length <= 256 &&
+                   isComplete(s + 1, led + SEGMENTS[s].length);
+}
+
+static_assert(isComplete(0, 0),
+              "the layout must cover leds 0 to LED_COUNT - 1 in order, on at "
+              "most MAX_SHELVES shelves of at most 256 leds");
+
+uint8_t shelves = 0;
+uint16_t lengths[Layout::MAX_SHELVES] = {};
+uint16_t starts[Layout::MAX_SHELVES + 1] = {};
+uint16_t pixelsByShelf[LED_COUNT];
+}  // namespace
+
+uint8_t Layout::shelfOf[LED_COUNT];
+uint8_t Layout::positionOf[LED_COUNT];
+
+void Layout::setup(uint16_t numberOfLeds) {
+  // Shelf lengths first, reversed segments count back from the far end.
+  shelves = 0;
+  memset(lengths, 0, sizeof(lengths));
+
+  for (uint8_t s = 0; s < SEGMENT_COUNT; s++) {
+    const Segment& segment = SEGMENTS[s];
+    if (segment.start >= numberOfLeds)
+      break;
+    if (segment.length > lengths[segment.shelf])
+      lengths[segment.shelf] = segment.length;
+    if (segment.shelf + 1 > shelves)
+      shelves = segment.shelf + 1;
+  }
+
+  for (uint8_t s = 0; s < SEGMENT_COUNT; s++) {
+    const Segment& segment = SEGMENTS[s];
+    for (uint16_t k = 0;
+         k < segment.length && segment.start + k < numberOfLeds; k++) {
+      shelfOf[segment.start + k] = segment.shelf;
+      positionOf[segment.start + k] =
+          segment.reversed ? lengths[segment.shelf] - 1 - k : k;
+    }
+  }
+
+  // Pixels grouped by shelf, in strip order within a shelf.
+  uint16_t next = 0;
+  for (uint8_t shelf = 0; shelf < shelves; shelf++) {
+    starts[shelf] = next;
+    for (uint16_t i = 0; i < numberOfLeds; i++) {
+      if (shelfOf[i] == shelf)
+        pixelsByShelf[next++] = i;
+    }
+  }
+  starts[shelves] = next;
+
+#ifdef DEBUG
+  Serial.printf("[layout] %i leds on %i shelves.\n", numberOfLeds, shelves);
+#endif
+}
+
+uint8_t Layout::shelfCount() {
+  return shelves;
+}
+
+uint16_t Layout::shelfLength(uint8_t shelf) {
+  return lengths[shelf];
+}
+
+const uint16_t* Layout::shelfPixels(uint8_t shelf, uint16_t& count) {
+  count = starts[shelf + 1] - starts[shelf];
+  return pixelsByShelf + starts[shelf];
+}
@@ -0,0 +1,57 @@
+/**
+ * Physical layout of the strip.
+ *
+ * The strip runs along the shelves as segments, and on a shelf usually
+ * doubles back on itself. Every build describes its strip in Layout.cpp as a
+ * table of segments in strip order, each with its shelf, first led, length
+ * and direction, picked with a LAYOUT_<name> build flag. setup() compiles
+ * the table into flat tables, so an effect can find the shelf and position
+ * along the shelf of any pixel, or the pixels of a shelf, with a single
+ * indexed read.
+ *
+ * Shelves are also the zones effects can be assigned to.
+ */
+#ifndef Layout_h
+#define Layout_h
+
+#include <Arduino.h>
+
+namespace Layout {
+
+const uint8_t MAX_SHELVES = 8;
+
+/**
+ * Leds start to start + length - 1 of the strip, along shelf. A reversed
+ * segment starts at the far end of the shelf and runs back.
+ */
+typedef struct Segment {
+  uint8_t shelf;
+  uint16_t start;
+  uint16_t length;
+  bool reversed;
+} Segment;
+
+extern uint8_t shelfOf[LED_COUNT];
+extern uint8_t positionOf[LED_COUNT];
+
+void setup(uint16_t numberOfLeds);
+
+uint8_t shelfCount();
+uint16_t shelfLength(uint8_t shelf);
+
+/** Shelf of pixel i. */
+inline uint8_t shelf(uint16_t i) {
+  return shelfOf[i];
+}
+
+/** Position of pixel i along its shelf, 0 is the start of the shelf. */
+inline uint8_t position(uint16_t i) {
+  return positionOf[i];
+}
+
+/** Pixels of a shelf, count is set to how many. */
+const uint16_t *shelfPixels(uint8_t shelf, uint16_t &count);
+
+}  // namespace Layout
+
+#endif  // Layout_h
@@ -0,0 +1,242 @@
+#include "LedOutput.hpp"
+
+#include <Clock.h>
+#include <stdio.h>
+#include <string.h>
+
+using namespace LedOutput;
+
+// ========================================================================
+// Output
+// ========================================================================
+bool LedOutput::Output::present(uint8_t brightness) {
+  uint32_t hash = frameHash(brightness);
+  uint32_t now = Clock::millis();
+
+  if (presentedFrames > 0 && hash == lastHash &&
+      (now - lastSent) < OUTPUT_KEEP_ALIVE) {
+    skippedFrames++;
+    return true;
+  }
+
+  if (!send(brightness)) {
+    droppedFrames++;
+    return false;
+  }
+
+  lastHash = hash;
+  lastSent = now;
+  presentedFrames++;
+  return true;
+}
+
+bool LedOutput::Output::addStrip(CLEDController& controller,
+                                uint16_t offset,
+                                uint16_t count) {
+  if (stripCount == OUTPUT_MAX_STRIPS)
+    return false;
+
+  strips[stripCount++] = {&controller, offset, count};
+
+#ifdef DEBUG
+  Serial.printf("[output] strip %i: %i leds from %i.\n", stripCount, count,
+                offset);
+#endif
+  return true;
+}
+
+void LedOutput::Output::bind(CRGB* buffer) {
+  for (uint8_t i = 0; i < stripCount; i++) {
+    strips[i].controller->setLeds(buffer + strips[i].offset, strips[i].count);
+  }
+}
+
+/**
+ * FNV-1a over brightness and pixels. At brightness 0 the pixels do not
+ * matter, so a dark strip hashes the same whatever the effect renders.
+ */
+uint32_t LedOutput::Output::frameHash(uint8_t brightness) {
+  uint32_t hash = (2166136261u ^ brightness) * 16777619u;
+  if (brightness == 0)
+    return hash;
+
+  const uint8_t* bytes = reinterpret_cast<const uint8_t*>(leds);
+  for (uint16_t i = 0; i < numberOfLeds * sizeof(CRGB); i++) {
+    hash = (hash ^ bytes[i]) * 16777619u;
+  }
+  return hash;
+}
+
+// ========================================================================
+// Direct
+// ========================================================================
+bool LedOutput::DirectOutput::send(uint8_t brightness) {
+  FastLED.show(brightness);
+  return true;
+}
+
+// ========================================================================
+// Pipelined, ESP32 only
+// ========================================================================
+#ifdef ESP32
+void LedOutput::PipelinedOutput::begin(CRGB* l, uint16_t n) {
+  Output::begin(l, n);
+
+  memcpy(front, leds, numberOfLeds * sizeof(CRGB));
+  bind(front);
+
+  idle = xSemaphoreCreateBinary();
+  xSemaphoreGive(idle);
+
+  xTaskCreatePinnedToCore(outputTask, "ledoutput", OUTPUT_TASK_STACK, this,
+                          OUTPUT_TASK_PRIORITY, &task, OUTPUT_TASK_CORE);
+  running = true;
+
+#ifdef DEBUG
+  Serial.printf("[output] pipelined output running on core %i.\n",
+                OUTPUT_TASK_CORE);
+#endif
+}
+
+/**
+ * Called from the render loop. Never waits for the strip: if the previous
+ * frame is still being pushed this one is dropped.
+ */
+bool LedOutput::PipelinedOutput::send(uint8_t brightness) {
+  if (!running) {
+    FastLED.show(brightness);
+    return true;
+  }
+
+  if (xSemaphoreTake(idle, 0) != pdTRUE)
+    return false;
+
+  memcpy(front, leds, numberOfLeds * sizeof(CRGB));
+  frontBrightness = brightness;
+
+  xTaskNotifyGive(task);
+  return true;
+}
+
+bool LedOutput::PipelinedOutput::busy() {
+  return running && (uxSemaphoreGetCount(idle) == 0);
+}
+
+void LedOutput::PipelinedOutput::stop() {
+  if (!running)
+    return;
+
+  xSemaphoreTake(idle, portMAX_DELAY);
+  vTaskDelete(task);
+  task = nullptr;
+  running = false;
+
+  bind(leds);
+  xSemaphoreGive(idle);
+}
+
+void LedOutput::PipelinedOutput::outputTask(void* self) {
+  PipelinedOutput* output = static_cast<PipelinedOutput*>(self);
+
+  for (;;) {
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    FastLED.show(output->frontBrightness);
+    xSemaphoreGive(output->idle);
+  }
+}
+#endif  // ESP32
+
+// ========================================================================
+// Mock
+// ========================================================================
+void LedOutput::MockOutput::begin(CRGB* l, uint16_t n) {
+  Output::begin(l, n);
+
+  delete[] front;
+  front = new CRGB[numberOfLeds];
+  memcpy(front, leds, numberOfLeds * sizeof(CRGB));
+}
+
+bool LedOutput::MockOutput::send(uint8_t brightness) {
+  if (busy())
+    return false;
+
+  memcpy(front, leds, numberOfLeds * sizeof(CRGB));
+  frontBrightness = brightness;
+  transferStart = Clock::micros();
+
+  FastLED.show(brightness);
+  return true;
+}
+
+bool LedOutput::MockOutput::busy() {
+  return (Clock::micros() - transferStart) < transferMicros &&
+         presentedFrames > 0;
+}
+
+// ========================================================================
+// Capture
+// ========================================================================
+LedOutput::CaptureOutput::~CaptureOutput() {
+  delete[] frames;
+  delete[] times;
+  delete[] brightnesses;
+}
+
+void LedOutput::CaptureOutput::begin(CRGB* l, uint16_t n) {
+  MockOutput::begin(l, n);
+
+  delete[] frames;
+  delete[] times;
+  delete[] brightnesses;
+  frames = new CRGB[capacity * numberOfLeds];
+  times = new uint32_t[capacity];
+  brightnesses = new uint8_t[capacity];
+  captured = 0;
+}
+
+bool LedOutput::CaptureOutput::send(uint8_t brightness) {
+  if (!MockOutput::send(brightness))
+    return false;
+
+  uint16_t slot = captured % capacity;
+  memcpy(frames + slot * numberOfLeds, leds, numberOfLeds * sizeof(CRGB));
+  times[slot] = Clock::micros();
+  brightnesses[slot] = brightness;
+  captured++;
+  return true;
+}
+
+uint16_t LedOutput::CaptureOutput::getKeptFrames() {
+  return (captured < capacity) ? captured : capacity;
+}
+
+const CRGB* LedOutput::CaptureOutput::getCaptured(uint16_t i,
+                                                  uint32_t& micros,
+                                                  uint8_t& brightness) {
+  uint16_t slot = (captured - getKeptFrames() + i) % capacity;
+  micros = times[slot];
+  brightness = brightnesses[slot];
+  return frames + slot * numberOfLeds;
+}
+
+bool LedOutput::CaptureOutput::save(const char* path) {
+  FILE* file = fopen(path, "w");
+  if (file == nullptr)
+    return false;
+
+  for (uint16_t i = 0; i < getKeptFrames(); i++) {
+    uint32_t micros;
+    uint8_t brightness;
+    const CRGB* frame = getCaptured(i, micros, brightness);
+
+    fprintf(file, "%u %u ", micros, brightness);
+    for (uint16_t p = 0; p < numberOfLeds; p++) {
+      fprintf(file, "%02x%02x%02x", frame[p].r, frame[p].g, frame[p].b);
+    }
+    fputc('\n', file);
+  }
+
+  fclose(file);
+  return true;
+}
@@ -0,0 +1,196 @@
+/**
+ * Ways of getting a rendered frame from the effect buffer onto the strip.
+ *
+ * Effects always render into the same buffer. An Output decides how and when
+ * that buffer is shown:
+ *
+ * - DirectOutput calls FastLED.show() in the caller, blocking it for the
+ *   whole transfer (about 11.5 ms for 384 WS2812B leds).
+ * - PipelinedOutput (ESP32) copies the frame into a front buffer and lets a
+ *   task on the other core push it, so the next frame renders meanwhile.
+ * - MockOutput keeps the last frame and simulates the transfer time on
+ *   Clock, for host builds.
+ * - CaptureOutput is a MockOutput that also records the frames it gets and
+ *   when, for checking host runs.
+ *
+ * The physical strips are registered with addStrip(), each showing a part
+ * of the frame. Clockless strips on separate pins are pushed at the same
+ * time by the ESP32 RMT driver in one FastLED.show(), so splitting a long
+ * strip divides the transfer time by the number of strips.
+ */
+#ifndef LEDOUTPUT_HPP
+#define LEDOUTPUT_HPP
+
+#include <Arduino.h>
+#include <FastLED.h>
+
+#ifdef ESP32
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+#endif
+
+#ifndef OUTPUT_KEEP_ALIVE
+#define OUTPUT_KEEP_ALIVE 1000
+#endif
+
+#define OUTPUT_MAX_STRIPS 4
+
+namespace LedOutput {
+
+/** A physical strip and the part of the frame it shows. */
+typedef struct Strip {
+  CLEDController* controller;
+  uint16_t offset;
+  uint16_t count;
+} Strip;
+
+class Output {
+ public:
+  virtual ~Output() {}
+
+  virtual void begin(CRGB* l, uint16_t n) {
+    leds = l;
+    numberOfLeds = n;
+  }
+
+  /**
+   * Adds a strip showing count pixels of the frame from offset. Returns
+   * false when there are OUTPUT_MAX_STRIPS already.
+   */
+  bool addStrip(CLEDController& controller, uint16_t offset, uint16_t count);
+  uint8_t getStripCount() { return stripCount; }
+  const Strip& getStrip(uint8_t i) { return strips[i]; }
+
+  /** Points every strip at its part of buffer. */
+  void bind(CRGB* buffer);
+
+  /**
+   * Hands the current contents of the effect buffer to the strip unless it
+   * is unchanged. Returns false when the output was still busy and the frame
+   * was dropped.
+   */
+  bool present(uint8_t brightness);
+  virtual bool busy() { return false; }
+
+  uint32_t getPresentedFrames() { return presentedFrames; }
+  uint32_t getSkippedFrames() { return skippedFrames; }
+  uint32_t getDroppedFrames() { return droppedFrames; }
+
+ protected:
+  CRGB* leds = nullptr;
+  uint16_t numberOfLeds = 0;
+  uint32_t presentedFrames = 0;
+  uint32_t skippedFrames = 0;
+  uint32_t droppedFrames = 0;
+  Strip strips[OUTPUT_MAX_STRIPS] = {};
+  uint8_t stripCount = 0;
+
+  /** Pushes the frame, false if the output is busy. */
+  virtual bool send(uint8_t brightness) = 0;
+
+ private:
+  uint32_t lastHash = 0;
+  uint32_t lastSent = 0;
+
+  uint32_t frameHash(uint8_t brightness);
+};
+
+class DirectOutput : public Output {
+ protected:
+  bool send(uint8_t brightness) override;
+};
+
+#ifdef ESP32
+#ifndef OUTPUT_TASK_CORE
+#define OUTPUT_TASK_CORE 0
+#endif
+#define OUTPUT_TASK_PRIORITY 2
+#define OUTPUT_TASK_STACK 4096
+
+class PipelinedOutput : public Output {
+ public:
+  void begin(CRGB* l, uint16_t n) override;
+  bool busy() override;
+
+  /**
+   * Waits for the frame in flight and points FastLED back at the effect
+   * buffer. Used before anything else calls FastLED.show() directly, like
+   * the firmware update.
+   */
+  void stop();
+
+ protected:
+  bool send(uint8_t brightness) override;
+
+ private:
+  CRGB front[LED_COUNT];
+  TaskHandle_t task = nullptr;
+  SemaphoreHandle_t idle = nullptr;
+  volatile uint8_t frontBrightness = 0;
+  bool running = false;
+
+  static void outputTask(void* self);
+};
+#endif  // ESP32
+
+class MockOutput : public Output {
+ public:
+  explicit MockOutput(uint32_t transferMicros = 0)
+      : transferMicros(transferMicros) {}
+  ~MockOutput() { delete[] front; }
+
+  void begin(CRGB* l, uint16_t n) override;
+  bool busy() override;
+
+  const CRGB* getFrame() { return front; }
+  uint8_t getBrightness() { return frontBrightness; }
+
+ protected:
+  bool send(uint8_t brightness) override;
+
+ private:
+  CRGB* front = nullptr;
+  uint8_t frontBrightness = 0;
+  uint32_t transferMicros;
+  uint32_t transferStart = 0;
+};
+
+class CaptureOutput : public MockOutput {
+ public:
+  /** Keeps the last capacity frames sent. */
+  explicit CaptureOutput(uint16_t capacity, uint32_t transferMicros = 0)
+      : MockOutput(transferMicros), capacity(capacity) {}
+  ~CaptureOutput();
+
+  void begin(CRGB* l, uint16_t n) override;
+
+  /** Frames captured since begin(), including ones no longer kept. */
+  uint32_t getCapturedFrames() { return captured; }
+  uint16_t getKeptFrames();
+
+  /**
+   * Kept frame i, 0 is the oldest. micros is when it was sent on Clock.
+   */
+  const CRGB* getCaptured(uint16_t i, uint32_t& micros, uint8_t& brightness);
+
+  /**
+   * Writes the kept frames to a text file, one line per frame: time in us,
+   * brightness and the pixels as rrggbb hex.
+   */
+  bool save(const char* path);
+
+ protected:
+  bool send(uint8_t brightness) override;
+
+ private:
+  uint16_t capacity;
+  uint32_t captured = 0;
+  CRGB* frames = nullptr;
+  uint32_t* times = nullptr;
+  uint8_t* brightnesses = nullptr;
+};
+
+}  // namespace LedOutput
+
+#endif  // LEDOUTPUT_HPP
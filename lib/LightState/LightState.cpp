@@ -91,7 +91,7 @@ LightState::LightState& LightState::Controller::parseNewState(
 
 LightState::LightState LightState::Controller::getLightStateFromPayload(
     std::string payload) {
-  StaticJsonDocument<256> data;
+  StaticJsonDocument<512> data;
   auto error = deserializeJson(data, payload);
 
   LightState newState = currentState;
@@ -144,6 +144,35 @@ LightState::LightState LightState::Controller::getLightStateFromPayload(
     }
   }
 
+  // {"layers": [{"effect": "Confetti", "blend": "add", "opacity": 128}]}
+  if (data.containsKey("layers") && data["layers"].is<JsonArray>()) {
+    newState.status.hasLayers = true;
+    newState.layerCount = 0;
+
+    for (JsonObject layer : data["layers"].as<JsonArray>()) {
+      if (newState.layerCount == LIGHT_MAX_LAYERS)
+        break;
+
+      Layer& l = newState.layers[newState.layerCount++];
+      l.effect = layer["effect"] | "";
+      l.blend = layer["blend"] | "add";
+      l.opacity = constrain(layer["opacity"] | 255, 0, 255);
+    }
+  }
+
+  // {"zones": ["", "Confetti"]}, by shelf from the bottom.
+  if (data.containsKey("zones") && data["zones"].is<JsonArray>()) {
+    newState.status.hasZones = true;
+    newState.zoneCount = 0;
+
+    for (JsonVariant zone : data["zones"].as<JsonArray>()) {
+      if (newState.zoneCount == LIGHT_MAX_ZONES)
+        break;
+
+      newState.zones[newState.zoneCount++] = zone | "";
+    }
+  }
+
   if (data.containsKey("color") && data["color"].is<JsonObject>()) {
     newState.status.hasColor = true;
     newState.color = {0};
@@ -227,6 +256,11 @@ void LightState::Controller::printStateDebug(LightState& state) {
   Serial.printf("  - has effect: %s, value: '%s'\n",
                 (state.status.hasEffect ? "true" : "false"),
                 state.effect.c_str());
+  Serial.printf("  - has layers: %s, count: %i\n",
+                (state.status.hasLayers ? "true" : "false"),
+                state.layerCount);
+  Serial.printf("  - has zones: %s, count: %i\n",
+                (state.status.hasZones ? "true" : "false"), state.zoneCount);
   Serial.printf("  - has color: %s, value: [%i,%i,%i,%0.2f,%0.2f]\n",
                 (state.status.hasColor ? "true" : "false"), state.color.r,
                 state.color.g, state.color.b, state.color.h, state.color.s);
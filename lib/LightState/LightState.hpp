@@ -15,6 +15,9 @@
 #define LIGHT_MQTT_JSON_NO_STATE 4
 #define LIGHT_STATEFILE_WROTE_SUCCESS 5
 
+#define LIGHT_MAX_LAYERS 3
+#define LIGHT_MAX_ZONES 8
+
 namespace LightState {
 
 typedef struct Color {
@@ -35,10 +38,22 @@ typedef struct LightStatus {
   bool hasColor;
   bool hasEffect;
   bool hasState;
+  bool hasLayers;
+  bool hasZones;
   bool success;
   uint8_t status;
 } LightStatus;
 
+/**
+ * Effect drawn over the main effect, blend is one of "add", "max", "alpha"
+ * or "multiply".
+ */
+typedef struct Layer {
+  std::string effect;
+  std::string blend;
+  uint8_t opacity;
+} Layer;
+
 typedef struct LightState {
   uint8_t brightness;
   uint8_t white_value;
@@ -46,6 +61,10 @@ typedef struct LightState {
   uint16_t transition;
   Color color;
   std::string effect;
+  Layer layers[LIGHT_MAX_LAYERS];
+  uint8_t layerCount;
+  std::string zones[LIGHT_MAX_ZONES];  // effect per shelf, "" follows effect
+  uint8_t zoneCount;
   bool state;
   LightStatus status;
 } LightState;
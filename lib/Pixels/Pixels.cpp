@@ -0,0 +1,428 @@
+#include "Pixels.h"
+
+typedef uint32_t __attribute__((__may_alias__)) word_t;
+
+static const uint32_t HIGH = 0x80808080;
+static const uint32_t LOW = 0x7F7F7F7F;
+static const uint32_t EVEN = 0x00FF00FF;
+
+/** Opacity as a multiplier out of 256, so 255 is exact. */
+static inline uint16_t weight(uint8_t opacity) {
+  return opacity + (opacity >> 7);
+}
+
+static inline bool aligned(const void* a, const void* b) {
+  return ((reinterpret_cast<uintptr_t>(a) | reinterpret_cast<uintptr_t>(b)) &
+          3) == 0;
+}
+
+// ========================================================================
+// Channels
+// ========================================================================
+static inline uint8_t scaleByte(uint8_t x, uint16_t scale) {
+  return (x * scale) >> 8;
+}
+
+static inline uint8_t lerpByte(uint8_t a, uint8_t b, uint16_t amount) {
+  return (a * (256 - amount) + b * amount) >> 8;
+}
+
+static inline uint8_t multiplyByte(uint8_t a, uint8_t b) {
+  return (a * (b + 1)) >> 8;
+}
+
+static inline uint8_t maxByte(uint8_t a, uint8_t b) {
+  return (a > b) ? a : b;
+}
+
+static inline uint8_t fadeByte(uint8_t cur, uint8_t target, uint8_t amount) {
+  if (cur == target || amount == 0)
+    return cur;
+
+  if (cur < target)
+    return cur + (((target - cur) * amount) >> 8) + 1;
+  return cur - (((cur - target) * amount) >> 8) - 1;
+}
+
+// ========================================================================
+// Words, four channels at a time
+// ========================================================================
+static inline uint32_t scaleWord(uint32_t x, uint16_t scale) {
+  uint32_t even = ((x & EVEN) * scale) >> 8;
+  uint32_t odd = ((x >> 8) & EVEN) * scale;
+  return (even & EVEN) | (odd & ~EVEN);
+}
+
+static inline uint32_t lerpWord(uint32_t a, uint32_t b, uint16_t amount) {
+  uint16_t inverse = 256 - amount;
+  uint32_t even = ((a & EVEN) * inverse + (b & EVEN) * amount) >> 8;
+  uint32_t odd = ((a >> 8) & EVEN) * inverse + ((b >> 8) & EVEN) * amount;
+  return (even & EVEN) | (odd & ~EVEN);
+}
+
+/** Adds the low seven bits, then works out the top bit and the carries. */
+static inline uint32_t addWord(uint32_t a, uint32_t b) {
+  uint32_t sum = (a & LOW) + (b & LOW);
+  uint32_t carry = ((a & b) | ((a | b) & sum)) & HIGH;
+  sum ^= (a ^ b) & HIGH;
+  return sum | ((carry >> 7) * 0xFF);
+}
+
+/**
+ * 0xFF in every byte where a >= b. a - b with the top bit of every byte
+ * preset cannot borrow from the next byte, and its top bit tells which low
+ * seven bits are larger.
+ */
+static inline uint32_t atLeastWord(uint32_t a, uint32_t b) {
+  uint32_t diff = (a | HIGH) - (b & LOW);
+  uint32_t ge = ((a & ~b) | (~(a ^ b) & diff)) & HIGH;
+  return (ge >> 7) * 0xFF;
+}
+
+/** 1 in every byte that is not 0. */
+static inline uint32_t nonZeroWord(uint32_t x) {
+  return ((((x & LOW) + LOW) | x) & HIGH) >> 7;
+}
+
+static inline uint32_t maxWord(uint32_t a, uint32_t b) {
+  uint32_t mask = atLeastWord(a, b);
+  return (a & mask) | (b & ~mask);
+}
+
+/**
+ * fadeByte() for four channels. Works on the distance between the larger
+ * and smaller of each pair, which no step can overshoot, so neither the add
+ * nor the subtract carries into the next byte.
+ */
+static inline uint32_t fadeWord(uint32_t cur, uint32_t target, uint8_t amount) {
+  uint32_t down = atLeastWord(cur, target);
+  uint32_t high = (cur & down) | (target & ~down);
+  uint32_t low = (target & down) | (cur & ~down);
+  uint32_t distance = high - low;
+
+  uint32_t step = scaleWord(distance, amount);
+  if (amount)
+    step += nonZeroWord(distance);
+
+  return ((high - step) & down) | ((low + step) & ~down);
+}
+
+// ========================================================================
+// Drivers
+// ========================================================================
+
+/**
+ * Runs op over the words of both buffers when words is set and they are
+ * aligned, and byteOp over whatever is left.
+ */
+template <typename WordOp, typename ByteOp>
+static inline void forEach(CRGB* dst,
+                           const CRGB* src,
+                           uint16_t n,
+                           bool words,
+                           WordOp op,
+                           ByteOp byteOp) {
+  uint8_t* d = dst[0].raw;
+  const uint8_t* s = src[0].raw;
+  uint16_t bytes = n * 3;
+  uint16_t i = 0;
+
+  if (words && aligned(d, s)) {
+    word_t* dw = reinterpret_cast<word_t*>(d);
+    const word_t* sw = reinterpret_cast<const word_t*>(s);
+    uint16_t count = bytes / 4;
+    for (uint16_t w = 0; w < count; w++) {
+      dw[w] = op(dw[w], sw[w]);
+    }
+    i = count * 4;
+  }
+
+  for (; i < bytes; i++) {
+    d[i] = byteOp(d[i], s[i]);
+  }
+}
+
+/**
+ * forEach() against a solid color. Three words hold four whole pixels, so
+ * the color repeats every third word.
+ */
+template <typename WordOp, typename ByteOp>
+static inline void forEachColor(CRGB* dst,
+                                const CRGB* src,
+                                uint16_t n,
+                                const CRGB& color,
+                                bool words,
+                                WordOp op,
+                                ByteOp byteOp) {
+  uint8_t* d = dst[0].raw;
+  const uint8_t* s = src[0].raw;
+  uint16_t bytes = n * 3;
+  uint16_t i = 0;
+
+  if (words && aligned(d, s)) {
+    uint8_t repeated[12];
+    for (uint8_t k = 0; k < 12; k++) {
+      repeated[k] = color.raw[k % 3];
+    }
+    uint32_t pattern[3];
+    memcpy(pattern, repeated, sizeof(pattern));
+
+    word_t* dw = reinterpret_cast<word_t*>(d);
+    const word_t* sw = reinterpret_cast<const word_t*>(s);
+    uint16_t count = bytes / 4;
+    uint8_t k = 0;
+    for (uint16_t w = 0; w < count; w++) {
+      dw[w] = op(sw[w], pattern[k]);
+      k = (k == 2) ? 0 : k + 1;
+    }
+    i = count * 4;
+  }
+
+  for (; i < bytes; i++) {
+    d[i] = byteOp(s[i], color.raw[i % 3]);
+  }
+}
+
+// ========================================================================
+// Kernels
+// ========================================================================
+static void fillPixels(CRGB* dst, uint16_t n, const CRGB& color, bool words) {
+  forEachColor(
+      dst, dst, n, color, words, [](uint32_t, uint32_t c) { return c; },
+      [](uint8_t, uint8_t c) { return c; });
+}
+
+static bool scalePixels(CRGB* dst, uint16_t n, uint8_t scale, bool words) {
+  uint16_t s = scale + 1;
+  uint32_t lit = 0;
+  forEach(
+      dst, dst, n, words,
+      [s, &lit](uint32_t a, uint32_t) {
+        uint32_t v = scaleWord(a, s);
+        lit |= v;
+        return v;
+      },
+      [s, &lit](uint8_t a, uint8_t) {
+        uint8_t v = scaleByte(a, s);
+        lit |= v;
+        return v;
+      });
+  return lit == 0;
+}
+
+static bool fadePixels(CRGB* dst,
+                       uint16_t n,
+                       const CRGB& color,
+                       uint8_t amount,
+                       bool words) {
+  uint32_t off = 0;
+  forEachColor(
+      dst, dst, n, color, words,
+      [amount, &off](uint32_t a, uint32_t c) {
+        uint32_t v = fadeWord(a, c, amount);
+        off |= v ^ c;
+        return v;
+      },
+      [amount, &off](uint8_t a, uint8_t c) {
+        uint8_t v = fadeByte(a, c, amount);
+        off |= v ^ c;
+        return v;
+      });
+  return off == 0;
+}
+
+static void lerpPixels(CRGB* dst,
+                       const CRGB* src,
+                       uint16_t n,
+                       uint16_t amount,
+                       bool words) {
+  forEach(
+      dst, src, n, words,
+      [amount](uint32_t a, uint32_t b) { return lerpWord(a, b, amount); },
+      [amount](uint8_t a, uint8_t b) { return lerpByte(a, b, amount); });
+}
+
+static void lerpTowardPixels(CRGB* dst,
+                             const CRGB* from,
+                             uint16_t n,
+                             const CRGB& color,
+                             uint16_t amount,
+                             bool words) {
+  forEachColor(
+      dst, from, n, color, words,
+      [amount](uint32_t a, uint32_t c) { return lerpWord(a, c, amount); },
+      [amount](uint8_t a, uint8_t c) { return lerpByte(a, c, amount); });
+}
+
+static void addPixels(CRGB* dst,
+                      const CRGB* src,
+                      uint16_t n,
+                      uint8_t opacity,
+                      bool words) {
+  uint16_t w = weight(opacity);
+  forEach(
+      dst, src, n, words,
+      [w](uint32_t a, uint32_t b) { return addWord(a, scaleWord(b, w)); },
+      [w](uint8_t a, uint8_t b) { return qadd8(a, scaleByte(b, w)); });
+}
+
+static void maxPixels(CRGB* dst,
+                      const CRGB* src,
+                      uint16_t n,
+                      uint8_t opacity,
+                      bool words) {
+  uint16_t w = weight(opacity);
+  forEach(
+      dst, src, n, words,
+      [w](uint32_t a, uint32_t b) { return maxWord(a, scaleWord(b, w)); },
+      [w](uint8_t a, uint8_t b) { return maxByte(a, scaleByte(b, w)); });
+}
+
+/**
+ * Always a byte at a time: every channel has its own multiplier, which a
+ * word cannot share, and taking the word apart cost twice the byte loop.
+ */
+static void multiplyPixels(CRGB* dst,
+                           const CRGB* src,
+                           uint16_t n,
+                           uint8_t opacity) {
+  uint16_t w = weight(opacity);
+  forEach(
+      dst, src, n, false, [](uint32_t a, uint32_t) { return a; },
+      [w](uint8_t a, uint8_t b) { return lerpByte(a, multiplyByte(a, b), w); });
+}
+
+void Pixels::fill(CRGB* dst, uint16_t n, const CRGB& color) {
+  fillPixels(dst, n, color, true);
+}
+
+bool Pixels::scale(CRGB* dst, uint16_t n, uint8_t scale) {
+  return scalePixels(dst, n, scale, true);
+}
+
+bool Pixels::fadeToBlackBy(CRGB* dst, uint16_t n, uint8_t fadeBy) {
+  return scalePixels(dst, n, 255 - fadeBy, true);
+}
+
+bool Pixels::fadeToward(CRGB* dst,
+                        uint16_t n,
+                        const CRGB& color,
+                        uint8_t amount) {
+  return fadePixels(dst, n, color, amount, true);
+}
+
+void Pixels::lerp(CRGB* dst, const CRGB* src, uint16_t n, uint16_t amount) {
+  lerpPixels(dst, src, n, amount, true);
+}
+
+void Pixels::lerpToward(CRGB* dst,
+                        const CRGB* from,
+                        uint16_t n,
+                        const CRGB& color,
+                        uint16_t amount) {
+  lerpTowardPixels(dst, from, n, color, amount, true);
+}
+
+void Pixels::add(CRGB* dst, const CRGB* src, uint16_t n, uint8_t opacity) {
+  addPixels(dst, src, n, opacity, true);
+}
+
+void Pixels::max(CRGB* dst, const CRGB* src, uint16_t n, uint8_t opacity) {
+  maxPixels(dst, src, n, opacity, true);
+}
+
+void Pixels::alpha(CRGB* dst, const CRGB* src, uint16_t n, uint8_t opacity) {
+  lerpPixels(dst, src, n, weight(opacity), true);
+}
+
+void Pixels::multiply(CRGB* dst,
+                      const CRGB* src,
+                      uint16_t n,
+                      uint8_t opacity) {
+  multiplyPixels(dst, src, n, opacity);
+}
+
+void Pixels::blend(Blend mode,
+                   CRGB* dst,
+                   const CRGB* src,
+                   uint16_t n,
+                   uint8_t opacity) {
+  if (opacity == 0)
+    return;
+
+  switch (mode) {
+    case Blend::Add:
+      add(dst, src, n, opacity);
+      break;
+    case Blend::Max:
+      max(dst, src, n, opacity);
+      break;
+    case Blend::Alpha:
+      alpha(dst, src, n, opacity);
+      break;
+    case Blend::Multiply:
+      multiply(dst, src, n, opacity);
+      break;
+  }
+}
+
+// ========================================================================
+// Scalar reference
+// ========================================================================
+void Pixels::Scalar::fill(CRGB* dst, uint16_t n, const CRGB& color) {
+  fillPixels(dst, n, color, false);
+}
+
+bool Pixels::Scalar::scale(CRGB* dst, uint16_t n, uint8_t scale) {
+  return scalePixels(dst, n, scale, false);
+}
+
+bool Pixels::Scalar::fadeToward(CRGB* dst,
+                                uint16_t n,
+                                const CRGB& color,
+                                uint8_t amount) {
+  return fadePixels(dst, n, color, amount, false);
+}
+
+void Pixels::Scalar::lerp(CRGB* dst,
+                          const CRGB* src,
+                          uint16_t n,
+                          uint16_t amount) {
+  lerpPixels(dst, src, n, amount, false);
+}
+
+void Pixels::Scalar::lerpToward(CRGB* dst,
+                                const CRGB* from,
+                                uint16_t n,
+                                const CRGB& color,
+                                uint16_t amount) {
+  lerpTowardPixels(dst, from, n, color, amount, false);
+}
+
+void Pixels::Scalar::add(CRGB* dst,
+                         const CRGB* src,
+                         uint16_t n,
+                         uint8_t opacity) {
+  addPixels(dst, src, n, opacity, false);
+}
+
+void Pixels::Scalar::max(CRGB* dst,
+                         const CRGB* src,
+                         uint16_t n,
+                         uint8_t opacity) {
+  maxPixels(dst, src, n, opacity, false);
+}
+
+void Pixels::Scalar::alpha(CRGB* dst,
+                           const CRGB* src,
+                           uint16_t n,
+                           uint8_t opacity) {
+  lerpPixels(dst, src, n, weight(opacity), false);
+}
+
+void Pixels::Scalar::multiply(CRGB* dst,
+                              const CRGB* src,
+                              uint16_t n,
+                              uint8_t opacity) {
+  multiplyPixels(dst, src, n, opacity);
+}
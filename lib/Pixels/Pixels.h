@@ -0,0 +1,84 @@
+/**
+ * Fade, fill and blend kernels for CRGB buffers.
+ *
+ * A CRGB buffer is worked on as a plain run of bytes, four channels at a time
+ * in a 32 bit word (SWAR), which is possible because every operation treats
+ * r, g and b alike. Buffers that are not 4 byte aligned, and the bytes left
+ * over at the end, go through the byte version of the same operation.
+ * multiply() always works a byte at a time, each channel has its own factor.
+ *
+ * The Scalar namespace has every kernel working one byte at a time. The
+ * results are the same, it is there as the reference to check against.
+ *
+ * Kernels that move pixels toward an end state return whether every pixel
+ * got there, worked out in the same pass.
+ */
+#ifndef PIXELS_H
+#define PIXELS_H
+
+#include <Arduino.h>
+#include <FastLED.h>
+
+namespace Pixels {
+
+typedef enum { Add, Max, Alpha, Multiply } Blend;
+
+/** Amounts for lerp() are out of LERP_END, so the end is exact. */
+const uint16_t LERP_END = 256;
+
+void fill(CRGB* dst, uint16_t n, const CRGB& color);
+
+/** dst = dst * (scale + 1) / 256, like nscale8(). Returns true if all black. */
+bool scale(CRGB* dst, uint16_t n, uint8_t scale);
+
+/** Same as fadeToBlackBy() from FastLED. Returns true if all black. */
+bool fadeToBlackBy(CRGB* dst, uint16_t n, uint8_t fadeBy);
+
+/**
+ * Moves every channel toward color by amount / 256 of the distance, at least
+ * one step. Returns true once all pixels are color.
+ */
+bool fadeToward(CRGB* dst, uint16_t n, const CRGB& color, uint8_t amount);
+
+/** dst = dst + (src - dst) * amount / LERP_END. */
+void lerp(CRGB* dst, const CRGB* src, uint16_t n, uint16_t amount);
+
+/** dst = from + (color - from) * amount / LERP_END. */
+void lerpToward(CRGB* dst, const CRGB* from, uint16_t n, const CRGB& color,
+                uint16_t amount);
+
+// Blend modes, opacity scales the contribution of src, 255 is full.
+
+/** dst = dst + src, saturating. */
+void add(CRGB* dst, const CRGB* src, uint16_t n, uint8_t opacity);
+
+/** dst = max(dst, src) per channel. */
+void max(CRGB* dst, const CRGB* src, uint16_t n, uint8_t opacity);
+
+/** dst = src over dst. */
+void alpha(CRGB* dst, const CRGB* src, uint16_t n, uint8_t opacity);
+
+/** dst = dst * src, src as a 0-255 filter. One byte at a time. */
+void multiply(CRGB* dst, const CRGB* src, uint16_t n, uint8_t opacity);
+
+void blend(Blend mode, CRGB* dst, const CRGB* src, uint16_t n,
+           uint8_t opacity);
+
+namespace Scalar {
+
+void fill(CRGB* dst, uint16_t n, const CRGB& color);
+bool scale(CRGB* dst, uint16_t n, uint8_t scale);
+bool fadeToward(CRGB* dst, uint16_t n, const CRGB& color, uint8_t amount);
+void lerp(CRGB* dst, const CRGB* src, uint16_t n, uint16_t amount);
+void lerpToward(CRGB* dst, const CRGB* from, uint16_t n, const CRGB& color,
+                uint16_t amount);
+void add(CRGB* dst, const CRGB* src, uint16_t n, uint8_t opacity);
+void max(CRGB* dst, const CRGB* src, uint16_t n, uint8_t opacity);
+void alpha(CRGB* dst, const CRGB* src, uint16_t n, uint8_t opacity);
+void multiply(CRGB* dst, const CRGB* src, uint16_t n, uint8_t opacity);
+
+}  // namespace Scalar
+
+}  // namespace Pixels
+
+#endif  // PIXELS_H
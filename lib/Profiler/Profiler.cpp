@@ -0,0 +1,78 @@
+#include "Profiler.h"
+
+static Profiler::Histogram histograms[Profiler::SLOTS][Profiler::StageCount];
+static uint8_t currentSlot = 0;
+static uint32_t cyclesPerMicro = 1;
+
+static const char* stageNames[] = {"network", "command", "effect", "fft",
+                                   "show"};
+
+void Profiler::setup() {
+#if defined(ESP32)
+  cyclesPerMicro = ESP.getCpuFreqMHz();
+#elif defined(TEENSY)
+  // The cycle counter is enabled by the Teensy 4 startup code.
+  cyclesPerMicro = F_CPU_ACTUAL / 1000000;
+#elif defined(NATIVE)
+  cyclesPerMicro = 1000;
+#endif
+  reset();
+}
+
+void Profiler::setSlot(uint8_t slot) {
+  currentSlot = (slot < SLOTS) ? slot : SLOTS - 1;
+}
+
+void Profiler::record(Stage stage, uint32_t cycles) {
+  Histogram& h = histograms[currentSlot][stage];
+
+  uint32_t micros = cycles / cyclesPerMicro;
+  uint8_t bucket = 0;
+  while (micros && bucket < BUCKETS - 1) {
+    micros >>= 1;
+    bucket++;
+  }
+
+  h.counts[bucket]++;
+  h.calls++;
+  h.total += cycles;
+  if (cycles > h.max)
+    h.max = cycles;
+}
+
+void Profiler::reset() {
+  memset(histograms, 0, sizeof(histograms));
+}
+
+const char* Profiler::getStageName(Stage stage) {
+  return (stage < StageCount) ? stageNames[stage] : "";
+}
+
+void Profiler::snapshot(SlotName name, Publisher publish) {
+  char message[384];
+
+  for (uint8_t slot = 0; slot < SLOTS; slot++) {
+    for (uint8_t s = 0; s < StageCount; s++) {
+      const Histogram& h = histograms[slot][s];
+      if (h.calls == 0)
+        continue;
+
+      int length = snprintf(
+          message, sizeof(message),
+          "{\"profile\":\"%s\",\"stage\":\"%s\",\"calls\":%u,"
+          "\"mean_us\":%u,\"max_us\":%u,\"buckets\":[",
+          name(slot), stageNames[s], h.calls,
+          static_cast<uint32_t>(h.total / h.calls / cyclesPerMicro),
+          h.max / cyclesPerMicro);
+
+      for (uint8_t b = 0; b < BUCKETS && length < (int)sizeof(message); b++) {
+        length += snprintf(message + length, sizeof(message) - length, "%s%u",
+                           b ? "," : "", h.counts[b]);
+      }
+      if (length < (int)sizeof(message))
+        snprintf(message + length, sizeof(message) - length, "]}");
+
+      publish(message);
+    }
+  }
+}
@@ -0,0 +1,67 @@
+/**
+ * Frame cost profiler.
+ *
+ * Records the cycles spent in each stage of the loop into fixed histograms,
+ * one set per slot (the running effect). A record is two cycle counter reads,
+ * a shift loop and a few adds, so it stays on in release builds.
+ *
+ * Buckets are powers of two in us: bucket 0 counts calls under 1 us, bucket
+ * k calls from 2^(k-1) up to 2^k us, and the last one everything longer.
+ */
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <Arduino.h>
+
+#if defined(NATIVE)
+#include <chrono>
+#endif
+
+namespace Profiler {
+
+typedef enum { Network, Command, Effect, Fft, Show, StageCount } Stage;
+
+const uint8_t SLOTS = 16;
+const uint8_t BUCKETS = 16;
+
+typedef struct Histogram {
+  uint32_t counts[BUCKETS];
+  uint32_t calls;
+  uint32_t max;
+  uint64_t total;
+} Histogram;
+
+typedef const char* (*SlotName)(uint8_t slot);
+typedef void (*Publisher)(const char* message);
+
+inline uint32_t cycles() {
+#if defined(ESP32)
+  return ESP.getCycleCount();
+#elif defined(TEENSY)
+  return ARM_DWT_CYCCNT;
+#elif defined(NATIVE)
+  // Nanoseconds, the host counts as a 1000 MHz CPU.
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+#else
+  return ::micros();
+#endif
+}
+
+void setup();
+void setSlot(uint8_t slot);
+void record(Stage stage, uint32_t cycles);
+void reset();
+
+const char* getStageName(Stage stage);
+
+/**
+ * Sends one JSON message per slot and stage that has calls, small enough for
+ * the MQTT buffer.
+ */
+void snapshot(SlotName name, Publisher publish);
+
+}  // namespace Profiler
+
+#endif  // PROFILER_H
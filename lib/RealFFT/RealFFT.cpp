@@ -0,0 +1,118 @@
+#include "RealFFT.h"
+
+#include <math.h>
+
+using RealFFT::SIZE;
+
+static const uint16_t HALF = SIZE / 2;
+static const uint16_t QUARTER = SIZE / 4;
+
+// Hamming weights of the first half, the window is symmetric.
+static float windowTable[HALF];
+// cos(2 pi k / SIZE) for k below SIZE / 2, sines are read from it too.
+static float cosTable[HALF];
+static bool tablesBuilt = false;
+
+static inline float cosAt(uint16_t k) { return cosTable[k]; }
+
+/** sin(2 pi k / SIZE) = cos(2 pi (k - SIZE / 4) / SIZE), for k < SIZE / 2. */
+static inline float sinAt(uint16_t k) {
+  return cosTable[(k >= QUARTER) ? k - QUARTER : QUARTER - k];
+}
+
+RealFFT::Transform::Transform() {
+  if (tablesBuilt)
+    return;
+
+  for (uint16_t i = 0; i < HALF; i++) {
+    windowTable[i] = 0.54 - 0.46 * cos(2 * M_PI * i / (SIZE - 1.0));
+    cosTable[i] = cos(2 * M_PI * i / SIZE);
+  }
+  tablesBuilt = true;
+}
+
+void RealFFT::Transform::magnitudes(float* samples, float* magnitudes) {
+  window(samples);
+  complexFFT(samples);
+  split(samples, magnitudes);
+}
+
+void RealFFT::Transform::window(float* samples) {
+  for (uint16_t i = 0; i < HALF; i++) {
+    samples[i] *= windowTable[i];
+    samples[SIZE - 1 - i] *= windowTable[i];
+  }
+}
+
+/**
+ * Radix-2 decimation in time over HALF complex values stored as re, im
+ * pairs. The twiddle for k of a span is entry k * SIZE / span of the table.
+ */
+void RealFFT::Transform::complexFFT(float* data) {
+  for (uint16_t i = 0, j = 0; i < HALF - 1; i++) {
+    if (i < j) {
+      float re = data[2 * i];
+      float im = data[2 * i + 1];
+      data[2 * i] = data[2 * j];
+      data[2 * i + 1] = data[2 * j + 1];
+      data[2 * j] = re;
+      data[2 * j + 1] = im;
+    }
+    uint16_t bit = HALF >> 1;
+    while (bit <= j) {
+      j -= bit;
+      bit >>= 1;
+    }
+    j += bit;
+  }
+
+  for (uint16_t span = 2; span <= HALF; span <<= 1) {
+    uint16_t half = span >> 1;
+    uint16_t stride = SIZE / span;
+
+    for (uint16_t k = 0; k < half; k++) {
+      float wr = cosAt(k * stride);
+      float wi = -sinAt(k * stride);
+
+      for (uint16_t i = k; i < HALF; i += span) {
+        float* a = data + 2 * i;
+        float* b = data + 2 * (i + half);
+        float tr = wr * b[0] - wi * b[1];
+        float ti = wr * b[1] + wi * b[0];
+        b[0] = a[0] - tr;
+        b[1] = a[1] - ti;
+        a[0] += tr;
+        a[1] += ti;
+      }
+    }
+  }
+}
+
+/**
+ * With Z the transform of the packed samples, the even samples have
+ * E = (Z[k] + conj(Z[HALF - k])) / 2, the odd ones
+ * O = (Z[k] - conj(Z[HALF - k])) / 2i, and X[k] = E + O e^(-2 pi i k / SIZE).
+ */
+void RealFFT::Transform::split(const float* data, float* magnitudes) {
+  magnitudes[0] = fabsf(data[0] + data[1]);
+  magnitudes[HALF] = fabsf(data[0] - data[1]);
+
+  for (uint16_t k = 1; k < HALF; k++) {
+    float zr = data[2 * k];
+    float zi = data[2 * k + 1];
+    float cr = data[2 * (HALF - k)];
+    float ci = -data[2 * (HALF - k) + 1];
+
+    float evenRe = 0.5f * (zr + cr);
+    float evenIm = 0.5f * (zi + ci);
+    // (z - c) / 2i
+    float oddRe = 0.5f * (zi - ci);
+    float oddIm = -0.5f * (zr - cr);
+
+    float wr = cosAt(k);
+    float wi = -sinAt(k);
+    float xr = evenRe + wr * oddRe - wi * oddIm;
+    float xi = evenIm + wr * oddIm + wi * oddRe;
+    magnitudes[k] = sqrtf(xr * xr + xi * xi);
+  }
+}
@@ -0,0 +1,50 @@
+/**
+ * Single precision FFT of real samples.
+ *
+ * The N samples are windowed and taken as N / 2 complex values, even samples
+ * real and odd ones imaginary. That is transformed with an N / 2 point
+ * radix-2 FFT in place, and one pass over the result separates the spectrum
+ * of the real signal. The window and the twiddle factors come from tables
+ * built once, so a transform calls no cos() and no sqrt() besides the one
+ * per bin for the magnitude.
+ *
+ * The window is the Hamming window of arduinoFFT and magnitudes are not
+ * normalized, like arduinoFFT's, so results compare one to one with it.
+ */
+#ifndef REALFFT_H
+#define REALFFT_H
+
+#include <Arduino.h>
+
+#ifndef REALFFT_SIZE
+#define REALFFT_SIZE 1024
+#endif
+
+namespace RealFFT {
+
+const uint16_t SIZE = REALFFT_SIZE;
+const uint16_t BINS = REALFFT_SIZE / 2 + 1;
+
+static_assert((SIZE & (SIZE - 1)) == 0 && SIZE >= 8,
+              "REALFFT_SIZE must be a power of two");
+
+class Transform {
+ private:
+  void window(float* samples);
+  void complexFFT(float* data);
+  void split(const float* data, float* magnitudes);
+
+ public:
+  /** Builds the shared tables the first time. */
+  Transform();
+
+  /**
+   * Windows and transforms SIZE samples and writes the magnitude of bins 0
+   * to SIZE / 2 to magnitudes. samples is used as the work buffer.
+   */
+  void magnitudes(float* samples, float* magnitudes);
+};
+
+}  // namespace RealFFT
+
+#endif  // REALFFT_H
@@ -0,0 +1,208 @@
+#include "Realtime.h"
+
+#include <Clock.h>
+#include <string.h>
+
+#if defined(ESP32)
+#include <lwip/sockets.h>
+#elif defined(NATIVE)
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+static uint8_t packet[REALTIME_PACKET_SIZE];
+
+// DDP header, 10 bytes, 14 with a timecode.
+#define DDP_HEADER 10
+#define DDP_FLAG_VERSION 0x40
+#define DDP_FLAG_TIMECODE 0x10
+#define DDP_FLAG_QUERY 0x02
+#define DDP_FLAG_PUSH 0x01
+#define DDP_DESTINATION 3
+#define DDP_ID_DISPLAY 1
+
+// E1.31 offsets, for the DMP layer of a data packet.
+#define E131_ACN_ID 4
+#define E131_OPTIONS 112
+#define E131_UNIVERSE 113
+#define E131_COUNT 123
+#define E131_START_CODE 125
+#define E131_DATA 126
+#define E131_OPTION_PREVIEW 0x80
+#define E131_OPTION_TERMINATED 0x40
+
+static const uint8_t E131_ID[12] = {'A', 'S', 'C', '-', 'E', '1',
+                                    '.', '1', '7', 0,   0,   0};
+
+static int openSocket(uint16_t port) {
+#ifdef REALTIME_SUPPORTED
+  int sock = socket(AF_INET, SOCK_DGRAM, 0);
+  if (sock < 0)
+    return -1;
+
+  struct sockaddr_in address = {};
+  address.sin_family = AF_INET;
+  address.sin_port = htons(port);
+  address.sin_addr.s_addr = htonl(INADDR_ANY);
+  if (bind(sock, reinterpret_cast<struct sockaddr*>(&address),
+           sizeof(address)) < 0) {
+    close(sock);
+    return -1;
+  }
+
+  fcntl(sock, F_SETFL, fcntl(sock, F_GETFL, 0) | O_NONBLOCK);
+  return sock;
+#else
+  return -1;
+#endif
+}
+
+bool Realtime::Receiver::begin(CRGB* l, uint16_t n) {
+  stop();
+  leds = l;
+  numberOfLeds = n;
+
+  ddpSocket = openSocket(DDP_PORT);
+  e131Socket = openSocket(E131_PORT);
+
+#ifdef DEBUG
+  Serial.printf("[realtime] listening for ddp: %s, e1.31: %s.\n",
+                (ddpSocket >= 0) ? "yes" : "no",
+                (e131Socket >= 0) ? "yes" : "no");
+#endif
+  return ddpSocket >= 0 || e131Socket >= 0;
+}
+
+void Realtime::Receiver::stop() {
+#ifdef REALTIME_SUPPORTED
+  if (ddpSocket >= 0)
+    close(ddpSocket);
+  if (e131Socket >= 0)
+    close(e131Socket);
+#endif
+  ddpSocket = -1;
+  e131Socket = -1;
+  protocol = Protocol::None;
+}
+
+bool Realtime::Receiver::poll() {
+  frameReady = false;
+  receive(ddpSocket);
+  receive(e131Socket);
+
+  if (isActive() && Clock::millis() - lastPacket > REALTIME_TIMEOUT) {
+#ifdef DEBUG
+    Serial.printf("[realtime] no packets for %i ms, back to effects.\n",
+                  REALTIME_TIMEOUT);
+#endif
+    protocol = Protocol::None;
+  }
+  return frameReady;
+}
+
+void Realtime::Receiver::receive(int sock) {
+#ifdef REALTIME_SUPPORTED
+  if (sock < 0)
+    return;
+
+  for (uint8_t i = 0; i < REALTIME_MAX_READS; i++) {
+    ssize_t size = recv(sock, packet, sizeof(packet), MSG_DONTWAIT);
+    if (size <= 0)
+      return;
+
+    Protocol from = (sock == ddpSocket) ? Protocol::Ddp : Protocol::E131;
+    bool accepted = (from == Protocol::Ddp) ? handleDdp(packet, size)
+                                            : handleE131(packet, size);
+    if (!accepted) {
+      rejected++;
+      continue;
+    }
+
+#ifdef DEBUG
+    if (protocol != from)
+      Serial.printf("[realtime] %s input started.\n",
+                    (from == Protocol::Ddp) ? "ddp" : "e1.31");
+#endif
+    packets++;
+    lastPacket = Clock::millis();
+    protocol = from;
+  }
+#endif
+}
+
+/**
+ * DDP: flags, sequence, data type, destination, 32 bit byte offset and 16
+ * bit length, big endian, then the data. Push marks the end of a frame.
+ * Only pixels for the display, destination 1 or the unset 0, are taken.
+ * Control, config and status packets go to other destinations.
+ */
+bool Realtime::Receiver::handleDdp(const uint8_t* data, uint16_t size) {
+  if (size < DDP_HEADER || (data[0] & 0xc0) != DDP_FLAG_VERSION ||
+      (data[0] & DDP_FLAG_QUERY) || data[DDP_DESTINATION] > DDP_ID_DISPLAY)
+    return false;
+
+  uint8_t header = DDP_HEADER;
+  if (data[0] & DDP_FLAG_TIMECODE)
+    header += 4;
+  uint32_t offset = (static_cast<uint32_t>(data[4]) << 24) |
+                    (static_cast<uint32_t>(data[5]) << 16) |
+                    (static_cast<uint32_t>(data[6]) << 8) | data[7];
+  uint16_t length = (data[8] << 8) | data[9];
+  if (size < header + length)
+    return false;
+
+  copy(offset, data + header, length);
+  if (data[0] & DDP_FLAG_PUSH)
+    frameReady = true;
+  return true;
+}
+
+/**
+ * E1.31 data packet: one universe of up to 512 DMX channels. A frame is
+ * complete with the universe holding the last led. Preview data is ignored.
+ */
+bool Realtime::Receiver::handleE131(const uint8_t* data, uint16_t size) {
+  if (size < E131_DATA || memcmp(data + E131_ACN_ID, E131_ID, 12) != 0 ||
+      data[E131_START_CODE] != 0 || (data[E131_OPTIONS] & E131_OPTION_PREVIEW))
+    return false;
+
+  if (data[E131_OPTIONS] & E131_OPTION_TERMINATED) {
+#ifdef DEBUG
+    Serial.println("[realtime] e1.31 source stopped, back to effects.");
+#endif
+    protocol = Protocol::None;
+    return false;
+  }
+
+  uint16_t universe = (data[E131_UNIVERSE] << 8) | data[E131_UNIVERSE + 1];
+  // The count includes the start code.
+  uint16_t channels = ((data[E131_COUNT] << 8) | data[E131_COUNT + 1]) - 1;
+  if (universe < REALTIME_UNIVERSE || channels > 512 ||
+      size < E131_DATA + channels)
+    return false;
+
+  uint32_t first = static_cast<uint32_t>(universe - REALTIME_UNIVERSE) *
+                   E131_LEDS_PER_UNIVERSE;
+  if (channels > E131_LEDS_PER_UNIVERSE * 3)
+    channels = E131_LEDS_PER_UNIVERSE * 3;
+
+  copy(first * 3, data + E131_DATA, channels);
+  if (first + E131_LEDS_PER_UNIVERSE >= numberOfLeds)
+    frameReady = true;
+  return true;
+}
+
+/** Copies bytes into the strip, dropping what falls past its end. */
+void Realtime::Receiver::copy(uint32_t byteOffset,
+                              const uint8_t* data,
+                              uint16_t length) {
+  uint32_t size = numberOfLeds * sizeof(CRGB);
+  if (byteOffset >= size)
+    return;
+  if (length > size - byteOffset)
+    length = size - byteOffset;
+
+  memcpy(reinterpret_cast<uint8_t*>(leds) + byteOffset, data, length);
+}
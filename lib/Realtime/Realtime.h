@@ -0,0 +1,92 @@
+/**
+ * Realtime pixel input over UDP, for driving the strip from a PC.
+ *
+ * Listens for DDP (port 4048) and E1.31 / sACN (port 5568) and copies the
+ * pixel data of every datagram straight from the one static receive buffer
+ * into the LED buffer. While packets keep coming the caller should show the
+ * buffer as it is and leave the effects alone. When none arrive for
+ * REALTIME_TIMEOUT ms, or an E1.31 source says it stopped, realtime ends.
+ *
+ * DDP data offsets are in bytes into the strip, packets for destinations
+ * other than the display (1, or 0 when unset) are dropped. E1.31 puts 170
+ * pixels in each universe, REALTIME_UNIVERSE and the ones after it fill the
+ * strip in order.
+ *
+ * Only ESP32 and the native build have a network stack, elsewhere begin()
+ * returns false.
+ */
+#ifndef REALTIME_H
+#define REALTIME_H
+
+#include <Arduino.h>
+#include <FastLED.h>
+
+#if defined(ESP32) || defined(NATIVE)
+#define REALTIME_SUPPORTED 1
+#endif
+
+#ifndef REALTIME_TIMEOUT
+#define REALTIME_TIMEOUT 2500
+#endif
+
+#ifndef REALTIME_UNIVERSE
+#define REALTIME_UNIVERSE 1
+#endif
+
+#define DDP_PORT 4048
+#define E131_PORT 5568
+
+// Largest datagram read, a full E1.31 universe is 638 bytes.
+#define REALTIME_PACKET_SIZE 1472
+
+// Datagrams read per poll, so a flood cannot starve the loop.
+#define REALTIME_MAX_READS 16
+
+namespace Realtime {
+
+typedef enum { None, Ddp, E131 } Protocol;
+
+const uint16_t E131_LEDS_PER_UNIVERSE = 170;
+
+class Receiver {
+ private:
+  int ddpSocket = -1;
+  int e131Socket = -1;
+  CRGB* leds = nullptr;
+  uint16_t numberOfLeds = 0;
+  Protocol protocol = Protocol::None;
+  uint32_t lastPacket = 0;
+  uint32_t packets = 0;
+  uint32_t rejected = 0;
+  bool frameReady = false;
+
+  void receive(int sock);
+  bool handleDdp(const uint8_t* data, uint16_t size);
+  bool handleE131(const uint8_t* data, uint16_t size);
+  void copy(uint32_t byteOffset, const uint8_t* data, uint16_t length);
+
+ public:
+  ~Receiver() { stop(); }
+
+  /** Opens the DDP and E1.31 sockets, pixels go to l. */
+  bool begin(CRGB* l, uint16_t n);
+  void stop();
+
+  /**
+   * Reads what has arrived without waiting. Returns true when a complete
+   * frame has been written into the buffer and should be shown.
+   */
+  bool poll();
+
+  /** Whether realtime input is driving the strip. */
+  bool isActive() { return protocol != Protocol::None; }
+  Protocol getProtocol() { return protocol; }
+
+  uint32_t getPackets() { return packets; }
+  /** Datagrams that were not used: malformed, preview or stream end. */
+  uint32_t getRejected() { return rejected; }
+};
+
+}  // namespace Realtime
+
+#endif  // REALTIME_H
@@ -0,0 +1,231 @@
+/*
+ * Automatic gain control on simulated band levels.
+ *
+ * Feeds Agc::Controller the levels of made up sounds at the Esp32FFT update
+ * rate and its settings, and checks what comes out. Beats of quiet and of
+ * loud music, over a quiet and over a loud noise floor, must all fill the
+ * range: high on the beat and low in between. Noise alone must stay dark,
+ * a sound must show within a few updates and fade soon after it stops,
+ * and a loud band must not hold a quiet one down. Every check is run after
+ * a few seconds of settling. The fade is timed again with updates 4 and
+ * 6.25 times as far apart, as when an effect reads the buckets less often,
+ * and must take as long within one update. Also times an update of 64 bands
+ * against the frame budget. Fails when a check does.
+ *
+ *   pio run -e native-bench-agc
+ *   .pio/build/native-bench-agc/program [updates] [output.json]
+ */
+#include <Arduino.h>
+#include <FastLED.h>
+
+#include <Agc.h>
+#include <Bench.h>
+
+// Esp32FFT: a spectrum every 256 samples at 40 kHz, magnitude units.
+#define UPDATE_MICROS 6400
+#define MIN_SPAN 16000
+#define UPDATES_PER_SECOND (1000000 / UPDATE_MICROS)
+#define SETTLE_SECONDS 4
+
+typedef struct Scenario {
+  const char* name;
+  uint32_t floor;  // noise level, +-10 %
+  uint32_t beat;  // level on the beat, every 500 ms for 100 ms
+  uint8_t minPeak;  // lowest output allowed on the beat
+  uint8_t maxQuiet;  // highest output allowed between beats
+} Scenario;
+
+const Scenario scenarios[] = {{"silence", 2000, 0, 0, 24},
+                              {"noisy room", 100000, 0, 0, 64},
+                              {"quiet music", 2000, 40000, 200, 48},
+                              {"loud music", 20000, 1500000, 200, 48},
+                              {"music in noise", 100000, 400000, 200, 64}};
+
+static Agc::Controller agc;
+static float levels[AGC_MAX_BANDS];
+static uint8_t buckets[AGC_MAX_BANDS];
+
+float noise(uint32_t floor) {
+  return floor * (0.9f + random16(205) / 1024.0f);
+}
+
+bool onBeat(uint32_t update) {
+  return (update % (UPDATES_PER_SECOND / 2)) < UPDATES_PER_SECOND / 10;
+}
+
+void begin(uint8_t bands) {
+  Agc::Settings settings = Agc::DEFAULTS;
+  settings.minSpan = MIN_SPAN;
+  agc.begin(bands, 1, settings);
+}
+
+/** Runs a scenario on one band, returns the lowest peak and highest lull. */
+void run(const Scenario& s, uint8_t& peak, uint8_t& quiet) {
+  begin(1);
+  peak = 255;
+  quiet = 0;
+  uint32_t settle = SETTLE_SECONDS * UPDATES_PER_SECOND;
+
+  for (uint32_t t = 0; t < settle * 2; t++) {
+    bool beat = s.beat && onBeat(t);
+    levels[0] = noise(s.floor) + (beat ? s.beat : 0);
+    agc.update(levels, buckets, UPDATE_MICROS);
+    if (t < settle)
+      continue;
+
+    // The end of every beat and the end of every lull.
+    uint32_t phase = t % (UPDATES_PER_SECOND / 2);
+    if (beat && phase == UPDATES_PER_SECOND / 10 - 1)
+      peak = min(peak, buckets[0]);
+    if (!s.beat || phase == UPDATES_PER_SECOND / 2 - 1)
+      quiet = max(quiet, buckets[0]);
+  }
+}
+
+/**
+ * Updates every updateMicros from silence to a sound until the output
+ * passes half scale, then after it stops until it is below 32. Both in ms,
+ * or 0 when never.
+ */
+void attackRelease(uint32_t updateMicros,
+                   uint32_t& attackMs,
+                   uint32_t& releaseMs) {
+  begin(1);
+  attackMs = 0;
+  releaseMs = 0;
+  uint32_t perSecond = 1000000 / updateMicros;
+
+  for (uint32_t t = 0; t < SETTLE_SECONDS * perSecond; t++) {
+    levels[0] = noise(2000);
+    agc.update(levels, buckets, updateMicros);
+  }
+  for (uint32_t t = 1; t <= perSecond; t++) {
+    levels[0] = noise(2000) + 200000;
+    agc.update(levels, buckets, updateMicros);
+    if (attackMs == 0 && buckets[0] >= 128)
+      attackMs = t * updateMicros / 1000;
+  }
+  for (uint32_t t = 1; t <= perSecond; t++) {
+    levels[0] = noise(2000);
+    agc.update(levels, buckets, updateMicros);
+    if (releaseMs == 0 && buckets[0] < 32)
+      releaseMs = t * updateMicros / 1000;
+  }
+}
+
+/** A loud and a quiet band beating together, returns the quiet band peak. */
+uint8_t independentBands() {
+  begin(2);
+  uint8_t peak = 255;
+  uint32_t settle = SETTLE_SECONDS * UPDATES_PER_SECOND;
+
+  for (uint32_t t = 0; t < settle * 2; t++) {
+    bool beat = onBeat(t);
+    levels[0] = noise(20000) + (beat ? 1500000 : 0);
+    levels[1] = noise(2000) + (beat ? 40000 : 0);
+    agc.update(levels, buckets, UPDATE_MICROS);
+    if (t >= settle && beat &&
+        t % (UPDATES_PER_SECOND / 2) == UPDATES_PER_SECOND / 10 - 1)
+      peak = min(peak, buckets[1]);
+  }
+  return peak;
+}
+
+int main(int argc, char** argv) {
+  uint32_t updates = (argc > 1) ? atol(argv[1]) : 200000;
+  FILE* out = Bench::openOutput((argc > 2) ? argv[2] : nullptr);
+  Serial.setOutput(nullptr);
+  random16_set_seed(1337);
+
+  fprintf(stderr, "[bench] update every %u us, min span %u\n", UPDATE_MICROS,
+          MIN_SPAN);
+  fprintf(stderr, "[bench] %-14s %5s %6s %7s\n", "scenario", "peak", "quiet",
+          "result");
+  fprintf(out, "{\n  \"scenarios\": [\n");
+
+  uint32_t failures = 0;
+  uint8_t n = sizeof(scenarios) / sizeof(scenarios[0]);
+  for (uint8_t c = 0; c < n; c++) {
+    const Scenario& s = scenarios[c];
+    uint8_t peak, quiet;
+    run(s, peak, quiet);
+
+    bool pass = (!s.beat || peak >= s.minPeak) && quiet <= s.maxQuiet;
+    if (!pass)
+      failures++;
+
+    fprintf(stderr, "[bench] %-14s %5u %6u %7s\n", s.name,
+            s.beat ? peak : 0, quiet, pass ? "ok" : "FAILED");
+    fprintf(out,
+            "    {\"name\": \"%s\", \"peak\": %u, \"quiet\": %u, "
+            "\"pass\": %s},\n",
+            s.name, s.beat ? peak : 0, quiet, pass ? "true" : "false");
+  }
+
+  uint32_t attackMs, releaseMs;
+  attackRelease(UPDATE_MICROS, attackMs, releaseMs);
+  bool timely = attackMs > 0 && attackMs <= 20 && releaseMs > 0 &&
+                releaseMs <= 600;
+  if (!timely)
+    failures++;
+  fprintf(stderr, "[bench] %-14s %4u ms %4u ms %s\n", "attack, release",
+          attackMs, releaseMs, timely ? "ok" : "FAILED");
+
+  // Read less often, as by VUMeter at 25 Hz or a governor reusing buckets.
+  const uint32_t slower[] = {UPDATE_MICROS * 4, 40000};
+  bool steady = true;
+  for (uint32_t micros : slower) {
+    uint32_t slowAttack, slowRelease;
+    attackRelease(micros, slowAttack, slowRelease);
+    bool same = slowRelease > 0 &&
+                abs(static_cast<int32_t>(slowRelease - releaseMs)) <=
+                    static_cast<int32_t>(micros / 1000);
+    steady = steady && same;
+    fprintf(stderr, "[bench] every %5u us %4u ms %4u ms %s\n", micros,
+            slowAttack, slowRelease, same ? "ok" : "FAILED");
+  }
+  if (!steady)
+    failures++;
+
+  uint8_t quietPeak = independentBands();
+  if (quietPeak < 200)
+    failures++;
+  fprintf(stderr, "[bench] %-14s %5u %13s\n", "quiet band", quietPeak,
+          (quietPeak < 200) ? "FAILED" : "ok");
+
+  // What levelling 64 bands costs once per frame, one or two hops apart
+  // like the frames come in.
+  begin(AGC_MAX_BANDS);
+  for (uint8_t b = 0; b < AGC_MAX_BANDS; b++) {
+    levels[b] = noise(20000) + b * 1000;
+  }
+  Bench::Timer timer;
+  timer.start();
+  for (uint32_t i = 0; i < updates; i++) {
+    levels[i & (AGC_MAX_BANDS - 1)] += (i & 1) ? 5000 : -5000;
+    uint32_t elapsed = (i % 3 == 2) ? 2 * UPDATE_MICROS : UPDATE_MICROS;
+    agc.update(levels, buckets, elapsed);
+  }
+  double nsUpdate = Bench::perFrame(timer.stop(updates).nanos, updates);
+  double budget = nsUpdate / (10000000.0 / FPS);
+  if (budget >= 1)
+    failures++;
+
+  fprintf(stderr, "[bench] 64 bands %.1f ns/update, %.4f%% of the frame\n",
+          nsUpdate, budget);
+  fprintf(stderr, "[bench] agc %s\n", failures ? "FAILED" : "ok");
+  fprintf(out,
+          "    {\"name\": \"attack release\", \"attack_ms\": %u, "
+          "\"release_ms\": %u, \"pass\": %s},\n"
+          "    {\"name\": \"slower updates\", \"pass\": %s},\n"
+          "    {\"name\": \"quiet band\", \"peak\": %u, \"pass\": %s}\n"
+          "  ],\n  \"ns_per_update\": %.1f,\n  \"frame_percent\": %.4f,\n"
+          "  \"pass\": %s\n}\n",
+          attackMs, releaseMs, timely ? "true" : "false",
+          steady ? "true" : "false", quietPeak,
+          (quietPeak < 200) ? "false" : "true", nsUpdate, budget,
+          failures ? "false" : "true");
+  Bench::closeOutput(out);
+
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,152 @@
+/*
+ * Band mapper tables and cost.
+ *
+ * Builds Bands::Mapper for the named six bands and for log and mel spacing
+ * from 6 to 64 bands at the ESP32 sample rate, and checks every table: each
+ * band has bins inside the spectrum, weights adding up to one and a centre
+ * above the one before. Then a tone at the centre of each band, without DC
+ * like Esp32FFT gives it, through RealFFT must come out loudest in that band
+ * or in one centred within a bin of it, where bands are narrower than the
+ * bins. Fails when any check does, and times map().
+ *
+ *   pio run -e native-bench-bands
+ *   .pio/build/native-bench-bands/program [maps] [output.json]
+ */
+#include <Arduino.h>
+#include <FastLED.h>
+
+#include <Bands.h>
+#include <Bench.h>
+#include <RealFFT.h>
+#include <math.h>
+
+#define SAMPLING_FREQUENCY 40000
+
+typedef struct Config {
+  const char* name;
+  Bands::Spacing spacing;
+  uint8_t count;
+} Config;
+
+const Config configs[] = {
+    {"named", Bands::Spacing::Named, 6}, {"log", Bands::Spacing::Log, 6},
+    {"log", Bands::Spacing::Log, 16},    {"mel", Bands::Spacing::Mel, 16},
+    {"log", Bands::Spacing::Log, 32},    {"mel", Bands::Spacing::Mel, 32},
+    {"log", Bands::Spacing::Log, 64},    {"mel", Bands::Spacing::Mel, 64}};
+
+static Bands::Mapper mapper;
+static RealFFT::Transform fft;
+static float samples[RealFFT::SIZE];
+static float magnitudes[RealFFT::BINS];
+static float levels[BANDS_MAX];
+
+/** Returns the number of bands with a broken table entry. */
+uint32_t checkTable(uint8_t count) {
+  uint32_t failures = 0;
+  uint16_t at = 0;
+  float previous = 0;
+
+  for (uint8_t b = 0; b < count; b++) {
+    const Bands::Band& band = mapper.getBand(b);
+    if (band.bins == 0 || band.first == 0 ||
+        band.first + band.bins > RealFFT::BINS || band.center <= previous)
+      failures++;
+    previous = band.center;
+    at += band.bins;
+  }
+
+  // With every magnitude one a band reads as the sum of its weights.
+  for (uint16_t k = 0; k < RealFFT::BINS; k++) {
+    magnitudes[k] = 1;
+  }
+  mapper.map(magnitudes, levels);
+  for (uint8_t b = 0; b < count; b++) {
+    if (fabsf(levels[b] - 1) > 1e-4)
+      failures++;
+  }
+
+  if (at != mapper.getWeightCount())
+    failures++;
+  return failures;
+}
+
+/** Returns the number of bands a tone at their centre missed. */
+uint32_t checkTones(uint8_t count) {
+  uint32_t failures = 0;
+  float binHz = static_cast<float>(SAMPLING_FREQUENCY) / RealFFT::SIZE;
+
+  for (uint8_t b = 0; b < count; b++) {
+    float hz = mapper.getBand(b).center;
+    for (uint16_t i = 0; i < RealFFT::SIZE; i++) {
+      samples[i] = 1500 * sin(2 * M_PI * hz * i / SAMPLING_FREQUENCY);
+    }
+    fft.magnitudes(samples, magnitudes);
+    mapper.map(magnitudes, levels);
+
+    uint8_t loudest = 0;
+    for (uint8_t c = 1; c < count; c++) {
+      if (levels[c] > levels[loudest])
+        loudest = c;
+    }
+    if (loudest != b && fabsf(mapper.getBand(loudest).center - hz) > binHz)
+      failures++;
+  }
+  return failures;
+}
+
+int main(int argc, char** argv) {
+  uint32_t maps = (argc > 1) ? atol(argv[1]) : 200000;
+  FILE* out = Bench::openOutput((argc > 2) ? argv[2] : nullptr);
+  Serial.setOutput(nullptr);
+
+  fprintf(stderr, "[bench] %u bins at %i Hz, %u maps per table\n",
+          RealFFT::BINS, SAMPLING_FREQUENCY, maps);
+  fprintf(stderr, "[bench] %-6s %5s %8s %6s %6s %8s %7s\n", "bands", "count",
+          "weights", "table", "tones", "ns/map", "result");
+  fprintf(out, "{\n  \"maps\": %u,\n  \"tables\": [\n", maps);
+
+  uint32_t failures = 0;
+  uint8_t n = sizeof(configs) / sizeof(configs[0]);
+  for (uint8_t c = 0; c < n; c++) {
+    const Config& config = configs[c];
+    bool built = mapper.build(config.spacing, config.count,
+                              SAMPLING_FREQUENCY, RealFFT::SIZE);
+    uint32_t table = built ? checkTable(config.count) : config.count;
+    uint32_t tones = built ? checkTones(config.count) : config.count;
+
+    Bench::Timer timer;
+    timer.start();
+    for (uint32_t i = 0; i < maps; i++) {
+      mapper.map(magnitudes, levels);
+    }
+    double nsMap = Bench::perFrame(timer.stop(maps).nanos, maps);
+
+    bool pass = built && mapper.getCount() == config.count && table == 0 &&
+                tones == 0;
+    if (!pass)
+      failures++;
+
+    fprintf(stderr, "[bench] %-6s %5u %8u %6u %6u %8.1f %7s\n", config.name,
+            config.count, mapper.getWeightCount(), table, tones, nsMap,
+            pass ? "ok" : "FAILED");
+    fprintf(out,
+            "    {\"spacing\": \"%s\", \"count\": %u, \"weights\": %u, "
+            "\"table_failures\": %u, \"tone_failures\": %u, "
+            "\"ns_per_map\": %.1f, \"pass\": %s}%s\n",
+            config.name, config.count, mapper.getWeightCount(), table, tones,
+            nsMap, pass ? "true" : "false", (c < n - 1) ? "," : "");
+  }
+
+  // Bad requests must be refused.
+  if (mapper.build(Bands::Spacing::Named, 8, SAMPLING_FREQUENCY,
+                   RealFFT::SIZE) ||
+      mapper.build(Bands::Spacing::Log, BANDS_MAX + 1, SAMPLING_FREQUENCY,
+                   RealFFT::SIZE))
+    failures++;
+
+  fprintf(stderr, "[bench] bands %s\n", failures ? "FAILED" : "ok");
+  fprintf(out, "  ],\n  \"pass\": %s\n}\n", failures ? "false" : "true");
+  Bench::closeOutput(out);
+
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,245 @@
+/*
+ * Audio capture ring buffer and windowing.
+ *
+ * Feeds AudioCapture::Ring a running sample counter, so any window read back
+ * must count up by one from sample to sample and end where it was asked to.
+ * Checked with writes of uneven sizes wrapping the ring many times, with old,
+ * overwritten and future windows, and with a writer thread racing a reader
+ * the way the I2S task races the render loop: a read may fail, but it may
+ * never return a torn window.
+ *
+ * Then Esp32FFT runs on the capture feeder with silence and then a synthetic
+ * tone on the virtual clock, and the tone has to land in the right bucket.
+ * Calls within one hop have to share a single analysis, and a stall must
+ * cost one analysis, not one per missed hop. Fails when any check does.
+ *
+ *   pio run -e native-bench-capture
+ *   .pio/build/native-bench-capture/program [seconds] [output.json]
+ */
+#include <Arduino.h>
+#include <FastLED.h>
+
+#include <AudioCapture.h>
+#include <Bench.h>
+#include <Clock.h>
+#include <Esp32FFT.h>
+#include <math.h>
+
+#include <atomic>
+#include <thread>
+
+#define WINDOW 1024
+#define TONE_HZ 1000
+#define TONE_AMPLITUDE 1500
+
+// Bucket the tone falls in, its bin is TONE_HZ * FFT_SAMPLES / rate.
+#define TONE_BUCKET 2
+
+static uint16_t window[WINDOW];
+static uint32_t toneSample = 0;
+static bool toneOn = false;
+static Esp32FFT fft;
+
+/** Whether the window counts up by one to the sample before end. */
+bool contiguous(const uint16_t* w, uint16_t n, uint32_t end) {
+  for (uint16_t i = 0; i < n; i++) {
+    if (w[i] != static_cast<uint16_t>(end - n + i))
+      return false;
+  }
+  return true;
+}
+
+uint32_t checkSequential() {
+  static AudioCapture::Ring ring;
+  static uint16_t chunk[509];
+  uint32_t failures = 0;
+  uint32_t counter = 0;
+
+  if (ring.latest(window, WINDOW))
+    failures++;  // nothing written yet
+
+  for (uint32_t round = 0; round < 2000; round++) {
+    uint16_t n = 1 + (round * 37) % 509;
+    for (uint16_t i = 0; i < n; i++) {
+      chunk[i] = counter++;
+    }
+    ring.write(chunk, n);
+    if (round % 3 == 0)
+      ring.write(static_cast<uint16_t>(counter++));
+
+    uint32_t end = ring.getWritten();
+    bool full = end >= WINDOW;
+    if (ring.latest(window, WINDOW) != full ||
+        (full && !contiguous(window, WINDOW, end)))
+      failures++;
+
+    // The oldest window still kept a DMA buffer clear of the writer, one
+    // closer and one not yet written.
+    uint32_t oldest = end - CAPTURE_RING_SIZE + CAPTURE_DMA_LENGTH + WINDOW;
+    if (end >= CAPTURE_RING_SIZE) {
+      if (!ring.read(oldest, window, WINDOW) ||
+          !contiguous(window, WINDOW, oldest))
+        failures++;
+      if (ring.read(oldest - 1, window, WINDOW))
+        failures++;
+    }
+    if (ring.read(end + 1, window, WINDOW))
+      failures++;
+  }
+
+  if (ring.read(ring.getWritten(), window,
+                CAPTURE_RING_SIZE - CAPTURE_DMA_LENGTH + 1))
+    failures++;
+  return failures;
+}
+
+/**
+ * Writer thread in DMA buffer sized chunks against a reader taking windows
+ * as fast as it can. Returns the number of torn windows let through.
+ */
+uint32_t checkConcurrent(uint32_t ms, uint32_t& reads, uint32_t& retries) {
+  static AudioCapture::Ring ring;
+  std::atomic<bool> running{true};
+
+  std::thread writer([&]() {
+    uint16_t chunk[CAPTURE_DMA_LENGTH];
+    uint32_t counter = 0;
+    while (running) {
+      for (uint16_t i = 0; i < CAPTURE_DMA_LENGTH; i++) {
+        chunk[i] = counter++;
+      }
+      ring.write(chunk, CAPTURE_DMA_LENGTH);
+    }
+  });
+
+  uint32_t torn = 0;
+  reads = 0;
+  retries = 0;
+  uint64_t stop = Bench::nanos() + ms * 1000000ull;
+  while (Bench::nanos() < stop) {
+    uint32_t end = ring.getWritten();
+    if (!ring.read(end, window, WINDOW)) {
+      retries++;
+      continue;
+    }
+    reads++;
+    if (!contiguous(window, WINDOW, end))
+      torn++;
+  }
+
+  running = false;
+  writer.join();
+  return torn;
+}
+
+uint16_t tone(uint8_t pin) {
+  if (!toneOn)
+    return 2048;
+  double t = static_cast<double>(toneSample++) / SAMPLING_FREQUENCY;
+  return 2048 + TONE_AMPLITUDE * sin(2 * M_PI * TONE_HZ * t);
+}
+
+/** Runs Esp32FFT on the tone, returns the loudest bucket. */
+uint8_t checkTone(std::array<uint8_t, FFT_BUCKETS>& buckets) {
+  setAnalogReadSource(tone);
+  Clock::useVirtual();
+  fft.setup();
+
+  // Nothing is captured yet, then a window of silence sets the noise floor
+  // and then the tone starts.
+  buckets = fft.getSampleSet();
+  Clock::advanceMillis(50);
+  fft.getSampleSet();
+  toneOn = true;
+  Clock::advanceMillis(50);
+  buckets = fft.getSampleSet();
+
+  uint8_t loudest = 0;
+  for (uint8_t b = 1; b < FFT_BUCKETS; b++) {
+    if (buckets[b] > buckets[loudest])
+      loudest = b;
+  }
+  return loudest;
+}
+
+/** Returns the number of wrong analysis counts. */
+uint32_t checkHops() {
+  uint32_t failures = 0;
+  uint32_t hopMicros = FFT_HOP * 1000000ull / SAMPLING_FREQUENCY;
+  uint32_t analyses = fft.getAnalyses();
+
+  for (uint8_t i = 0; i < 8; i++) {
+    fft.getSampleSet();
+  }
+  if (fft.getAnalyses() != analyses)
+    failures++;
+
+  for (uint8_t hop = 0; hop < 16; hop++) {
+    Clock::advanceMicros(hopMicros);
+    fft.getSampleSet();
+    fft.getSampleSet();
+    if (fft.getAnalyses() != ++analyses)
+      failures++;
+  }
+
+  Clock::advanceMillis(200);
+  fft.getSampleSet();
+  if (fft.getAnalyses() != ++analyses)
+    failures++;
+  return failures;
+}
+
+int main(int argc, char** argv) {
+  uint32_t seconds = (argc > 1) ? atol(argv[1]) : 2;
+  FILE* out = Bench::openOutput((argc > 2) ? argv[2] : nullptr);
+  Serial.setOutput(nullptr);
+
+  uint32_t sequential = checkSequential();
+  fprintf(stderr, "[bench] sequential failures: %u\n", sequential);
+
+  uint32_t reads, retries;
+  uint32_t torn = checkConcurrent(seconds * 1000, reads, retries);
+  fprintf(stderr, "[bench] concurrent reads: %u retries: %u torn: %u\n",
+          reads, retries, torn);
+
+  // What taking the newest window costs the render loop.
+  static AudioCapture::Ring ring;
+  for (uint32_t i = 0; i < CAPTURE_RING_SIZE; i++) {
+    ring.write(static_cast<uint16_t>(i));
+  }
+  uint32_t windows = 200000;
+  Bench::Timer timer;
+  timer.start();
+  for (uint32_t i = 0; i < windows; i++) {
+    ring.latest(window, WINDOW);
+  }
+  double nsWindow = Bench::perFrame(timer.stop(windows).nanos, windows);
+  fprintf(stderr, "[bench] latest window %.1f ns, blocking capture %u us\n",
+          nsWindow, WINDOW * 1000000 / SAMPLING_FREQUENCY);
+
+  std::array<uint8_t, FFT_BUCKETS> buckets;
+  uint8_t loudest = checkTone(buckets);
+  fprintf(stderr, "[bench] %i Hz tone buckets:", TONE_HZ);
+  for (uint8_t b = 0; b < FFT_BUCKETS; b++) {
+    fprintf(stderr, " %3u", buckets[b]);
+  }
+  fprintf(stderr, ", loudest %u\n", loudest);
+
+  uint32_t hops = checkHops();
+  fprintf(stderr, "[bench] hop %u samples, analysis failures: %u\n", FFT_HOP,
+          hops);
+
+  bool pass = sequential == 0 && torn == 0 && reads > 0 && hops == 0 &&
+              loudest == TONE_BUCKET && buckets[TONE_BUCKET] > 0;
+  fprintf(stderr, "[bench] capture %s\n", pass ? "ok" : "FAILED");
+  fprintf(out,
+          "{\n  \"sequential_failures\": %u,\n  \"concurrent_reads\": %u,\n"
+          "  \"concurrent_retries\": %u,\n  \"torn\": %u,\n"
+          "  \"ns_per_window\": %.1f,\n  \"tone_bucket\": %u,\n"
+          "  \"hop_failures\": %u,\n  \"pass\": %s\n}\n",
+          sequential, reads, retries, torn, nsWindow, loudest, hops,
+          pass ? "true" : "false");
+  Bench::closeOutput(out);
+
+  return pass ? 0 : 1;
+}
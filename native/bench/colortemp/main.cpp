@@ -0,0 +1,173 @@
+/*
+ * Color temperature benchmark and accuracy check.
+ *
+ * Compares ColorTemperature::fromMired() against the pow()/log() formula
+ * Effects::Controller used before (Tanner Helland's approximation, with the
+ * Kelvin value truncated to 100 K steps) for every mired value Home
+ * Assistant sends, and times both, keeping the fastest of ROUNDS runs. Fails
+ * when the table is off or not faster than the formula.
+ *
+ * With --table it prints the table in lib/Effects/ColorTemperature.cpp,
+ * computed from the same formula without the 100 K truncation.
+ *
+ *   pio run -e native-bench-colortemp
+ *   .pio/build/native-bench-colortemp/program [iterations] [output.json]
+ *   .pio/build/native-bench-colortemp/program --table
+ */
+#include <Arduino.h>
+#include <FastLED.h>
+
+#include <Bench.h>
+#include <ColorTemperature.hpp>
+#include <math.h>
+#include <string.h>
+
+using ColorTemperature::MIRED_MAX;
+using ColorTemperature::MIRED_MIN;
+using ColorTemperature::MIRED_STEP;
+using ColorTemperature::TABLE_SIZE;
+
+// Largest difference per channel allowed against the old formula. Its 100 K
+// steps are up to 13 counts apart in blue at the warm end.
+#define MAX_ERROR_FORMULA 16
+
+// Largest difference allowed against the same formula without truncation.
+#define MAX_ERROR_SMOOTH 2
+
+// Timed runs of each version, the fastest counts.
+#define ROUNDS 5
+
+double clamp(double value) {
+  if (value < 0)
+    return 0;
+  if (value > 255)
+    return 255;
+  return value;
+}
+
+/**
+ * The conversion from Effects::handleStateChange. temp is Kelvin / 100.
+ */
+void formula(double temp, double rgb[3]) {
+  if (temp <= 66) {
+    rgb[0] = 255;
+  } else {
+    rgb[0] = clamp(329.698727446 * pow(temp - 60, -0.1332047592));
+  }
+
+  if (temp <= 66) {
+    rgb[1] = clamp(99.4708025861 * log(temp) - 161.1195681661);
+  } else {
+    rgb[1] = clamp(288.1221695283 * pow(temp - 60, -0.0755148492));
+  }
+
+  if (temp >= 66) {
+    rgb[2] = 255;
+  } else if (temp <= 19) {
+    rgb[2] = 0;
+  } else {
+    rgb[2] = clamp(138.5177312231 * log(temp - 10) - 305.0447927307);
+  }
+}
+
+CRGB formulaFromMired(uint16_t mired) {
+  unsigned int kelvin = (1000000 / mired);
+  double rgb[3];
+  formula(kelvin / 100, rgb);
+  return CRGB(rgb[0], rgb[1], rgb[2]);
+}
+
+void smoothFromMired(uint16_t mired, double rgb[3]) {
+  formula(1000000.0 / mired / 100.0, rgb);
+}
+
+void printTable() {
+  printf("const uint8_t ColorTemperature::table[TABLE_SIZE][3] = {\n");
+  for (uint8_t i = 0; i < TABLE_SIZE; i++) {
+    uint16_t mired = MIRED_MIN + i * MIRED_STEP;
+    double rgb[3];
+    smoothFromMired(mired, rgb);
+    printf("    {%3li, %3li, %3li},  // %u mired\n", lround(rgb[0]),
+           lround(rgb[1]), lround(rgb[2]), mired);
+  }
+  printf("};\n");
+}
+
+int main(int argc, char** argv) {
+  if (argc > 1 && strcmp(argv[1], "--table") == 0) {
+    printTable();
+    return 0;
+  }
+
+  uint32_t iterations = (argc > 1) ? atol(argv[1]) : 2000;
+  FILE* out = Bench::openOutput((argc > 2) ? argv[2] : nullptr);
+
+  // Accuracy over the whole range.
+  int maxFormula[3] = {0, 0, 0};
+  double maxSmooth[3] = {0, 0, 0};
+  for (uint16_t m = MIRED_MIN; m <= MIRED_MAX; m++) {
+    CRGB table = ColorTemperature::fromMired(m);
+    CRGB old = formulaFromMired(m);
+    double smooth[3];
+    smoothFromMired(m, smooth);
+
+    for (uint8_t c = 0; c < 3; c++) {
+      maxFormula[c] = max(maxFormula[c], abs(table.raw[c] - old.raw[c]));
+      maxSmooth[c] = max(maxSmooth[c], fabs(table.raw[c] - smooth[c]));
+    }
+  }
+
+  // Timing, every mired value per iteration.
+  uint32_t calls = iterations * (MIRED_MAX - MIRED_MIN + 1);
+  uint32_t sink = 0;
+
+  Bench::Sample formulaSample = Bench::fastest(ROUNDS, calls, [&]() {
+    for (uint32_t i = 0; i < iterations; i++) {
+      for (uint16_t m = MIRED_MIN; m <= MIRED_MAX; m++) {
+        CRGB c = formulaFromMired(m);
+        sink += c.r + c.g + c.b;
+      }
+    }
+  });
+
+  Bench::Sample tableSample = Bench::fastest(ROUNDS, calls, [&]() {
+    for (uint32_t i = 0; i < iterations; i++) {
+      for (uint16_t m = MIRED_MIN; m <= MIRED_MAX; m++) {
+        CRGB c = ColorTemperature::fromMired(m);
+        sink += c.r + c.g + c.b;
+      }
+    }
+  });
+
+  double nsFormula = Bench::perFrame(formulaSample.nanos, calls);
+  double nsTable = Bench::perFrame(tableSample.nanos, calls);
+
+  bool accurate = true;
+  for (uint8_t c = 0; c < 3; c++) {
+    accurate = accurate && maxFormula[c] <= MAX_ERROR_FORMULA &&
+               maxSmooth[c] <= MAX_ERROR_SMOOTH;
+  }
+  bool faster = nsTable < nsFormula;
+  bool pass = accurate && faster;
+
+  fprintf(stderr, "[bench] color temp: formula %.1f ns, table %.1f ns (%u)\n",
+          nsFormula, nsTable, sink & 1);
+  fprintf(stderr, "[bench] max error vs formula: r %i g %i b %i\n",
+          maxFormula[0], maxFormula[1], maxFormula[2]);
+  fprintf(stderr, "[bench] max error vs smooth formula: r %.2f g %.2f b %.2f\n",
+          maxSmooth[0], maxSmooth[1], maxSmooth[2]);
+  fprintf(stderr, "[bench] accuracy %s\n", accurate ? "ok" : "FAILED");
+  fprintf(stderr, "[bench] table faster %s\n", faster ? "ok" : "FAILED");
+
+  fprintf(out,
+          "{\n  \"formula_ns\": %.1f,\n  \"table_ns\": %.1f,\n"
+          "  \"max_error_formula\": [%i, %i, %i],\n"
+          "  \"max_error_smooth\": [%.2f, %.2f, %.2f],\n"
+          "  \"table_faster\": %s,\n  \"pass\": %s\n}\n",
+          nsFormula, nsTable, maxFormula[0], maxFormula[1], maxFormula[2],
+          maxSmooth[0], maxSmooth[1], maxSmooth[2], faster ? "true" : "false",
+          pass ? "true" : "false");
+  Bench::closeOutput(out);
+
+  return pass ? 0 : 1;
+}
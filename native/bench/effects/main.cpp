@@ -0,0 +1,285 @@
+/*
+ * Per effect render benchmark.
+ *
+ * Runs every effect of Effects::Controller for a number of frames at the
+ * LED_COUNT this binary was built for and reports ns/frame, ns/pixel and heap
+ * allocations per frame. Results are written as JSON so runs from different
+ * commits can be compared.
+ *
+ * The clock is virtual and advances one output frame per call, so every
+ * call renders and results are repeatable. Effects with a lower update rate
+ * than FPS only render on some frames, and their numbers average rendering
+ * and skipped frames.
+ *
+ * A case runs brightness and color transitions next to each other,
+ * restarted regularly like incoming state changes would, to check that the
+ * command path does not allocate. The layer cases run Gradient with Confetti
+ * blended over it in every blend mode, and once at opacity 0, which should
+ * cost the same as Gradient alone. The crossfade case switches between
+ * Rainbow and Gradient every half second with the default one second
+ * transition, so every frame renders both effects. The HDR output case
+ * times widening a rendered frame to 16 bits and dithering it back at a
+ * fractional brightness. The profiler case times the five records the
+ * device loop makes per frame, reported as a share of the frame budget.
+ *
+ *   pio run -e native-bench-384
+ *   .pio/build/native-bench-384/program [frames] [output.json]
+ */
+#include <Arduino.h>
+#include <FastLED.h>
+
+#include <Bench.h>
+#include <Clock.h>
+#include <Effects.hpp>
+#include <Hdr.h>
+#include <LightState.hpp>
+#include <Profiler.h>
+
+// Room past LED_COUNT, so an effect that writes past the strip again does
+// not corrupt the bench. The native runner reports such writes.
+#define LED_GUARD 128
+
+alignas(4) CRGB leds[LED_COUNT + LED_GUARD];
+Effects::Controller effects;
+LightState::Controller lightState;
+
+typedef struct EffectCase {
+  const char* name;
+  Effects::Effect effect;
+} EffectCase;
+
+const EffectCase cases[] = {
+    {"Rainbow", Effects::Effect::Rainbow},
+    {"Glitter Rainbow", Effects::Effect::GlitterRainbow},
+    {"Gradient", Effects::Effect::Gradient},
+    {"RainbowByShelf", Effects::Effect::RainbowByShelf},
+    {"BPM", Effects::Effect::BPM},
+    {"Confetti", Effects::Effect::Confetti},
+    {"Juggle", Effects::Effect::Juggle},
+    {"Sinelon", Effects::Effect::Sinelon},
+    {"VUMeter", Effects::Effect::VUMeter},
+    {"Frequencies", Effects::Effect::Frequencies},
+    {"Music Dancer", Effects::Effect::MusicDancer},
+    {"Pride", Effects::Effect::Pride},
+    {"Colorloop", Effects::Effect::Colorloop},
+    {"Walking Rainbow", Effects::Effect::WalkingRainbow}};
+
+typedef struct LayerCase {
+  const char* name;
+  Pixels::Blend blend;
+  uint8_t opacity;
+} LayerCase;
+
+const LayerCase layerCases[] = {
+    {"+Confetti add", Pixels::Blend::Add, 255},
+    {"+Confetti max", Pixels::Blend::Max, 255},
+    {"+Confetti alpha", Pixels::Blend::Alpha, 128},
+    {"+Confetti mult", Pixels::Blend::Multiply, 255},
+    {"+Confetti off", Pixels::Blend::Add, 0}};
+
+const uint32_t WARMUP_FRAMES = 100;
+const uint32_t COMMAND_RESTART = 360;
+const uint32_t CROSSFADE_RESTART = FPS / 2;
+
+Bench::Sample benchEffect(Effects::Effect effect, uint32_t frames) {
+  random16_set_seed(1337);
+  effects.setCurrentEffect(effect);
+
+  for (uint32_t i = 0; i < WARMUP_FRAMES; i++) {
+    effects.renderFrame();
+    Clock::advanceMicros(Effects::FRAME_MICROS);
+  }
+
+  Bench::Timer timer;
+  timer.start();
+  for (uint32_t i = 0; i < frames; i++) {
+    effects.renderFrame();
+    Clock::advanceMicros(Effects::FRAME_MICROS);
+  }
+  return timer.stop(frames);
+}
+
+Bench::Sample benchLayer(const LayerCase& layer, uint32_t frames) {
+  random16_set_seed(1337);
+  effects.setCurrentEffect(Effects::Effect::Gradient);
+  effects.setLayer(0, Effects::Effect::Confetti, layer.blend, layer.opacity);
+
+  for (uint32_t i = 0; i < WARMUP_FRAMES; i++) {
+    effects.renderFrame();
+    Clock::advanceMicros(Effects::FRAME_MICROS);
+  }
+
+  Bench::Timer timer;
+  timer.start();
+  for (uint32_t i = 0; i < frames; i++) {
+    effects.renderFrame();
+    Clock::advanceMicros(Effects::FRAME_MICROS);
+  }
+  Bench::Sample s = timer.stop(frames);
+
+  effects.clearLayers();
+  return s;
+}
+
+Bench::Sample benchCrossfade(uint32_t frames) {
+  random16_set_seed(1337);
+  effects.setCurrentEffect(Effects::Effect::Rainbow);
+
+  Bench::Timer timer;
+  timer.start();
+  for (uint32_t i = 0; i < frames; i++) {
+    if (i % CROSSFADE_RESTART == 0) {
+      bool odd = (i / CROSSFADE_RESTART) % 2;
+      effects.setCurrentEffect(std::string(odd ? "Rainbow" : "Gradient"));
+    }
+
+    effects.renderFrame();
+    Clock::advanceMicros(Effects::FRAME_MICROS);
+  }
+  Bench::Sample s = timer.stop(frames);
+
+  effects.setCurrentEffect(Effects::Effect::NullEffect);
+  return s;
+}
+
+Bench::Sample benchHdrOutput(uint32_t frames) {
+  static Hdr::CRGB16 hdr[LED_COUNT];
+  static CRGB frame[LED_COUNT];
+  static Hdr::Dither dither;
+
+  effects.setCurrentEffect(Effects::Effect::Rainbow);
+  effects.renderFrame();
+
+  Bench::Timer timer;
+  timer.start();
+  for (uint32_t i = 0; i < frames; i++) {
+    uint16_t scale;
+    Hdr::splitBrightness(1000 + i, scale);
+    Hdr::widen(leds, hdr, LED_COUNT);
+    dither.render(hdr, frame, LED_COUNT, scale);
+  }
+  return timer.stop(frames);
+}
+
+Bench::Sample benchCommands(uint32_t frames) {
+  LightState::LightState state = lightState.getCurrentState();
+  state.state = true;
+  state.status = {false};
+  state.status.hasBrightness = true;
+  state.status.hasColor = true;
+
+  effects.setCurrentEffect(Effects::Effect::NullEffect);
+
+  Bench::Timer timer;
+  timer.start();
+  for (uint32_t i = 0; i < frames; i++) {
+    if (i % COMMAND_RESTART == 0) {
+      bool odd = (i / COMMAND_RESTART) % 2;
+      state.brightness = odd ? 64 : 255;
+      state.color.r = odd ? 255 : 0;
+      state.color.b = odd ? 0 : 255;
+      effects.handleStateChange(state);
+    }
+
+    effects.renderFrame();
+    Clock::advanceMicros(Effects::FRAME_MICROS);
+  }
+  return timer.stop(frames);
+}
+
+Bench::Sample benchProfiler(uint32_t frames) {
+  Profiler::reset();
+
+  Bench::Timer timer;
+  timer.start();
+  for (uint32_t i = 0; i < frames; i++) {
+    Profiler::setSlot(i % Profiler::SLOTS);
+    for (uint8_t s = 0; s < Profiler::StageCount; s++) {
+      uint32_t start = Profiler::cycles();
+      Profiler::record(static_cast<Profiler::Stage>(s),
+                       Profiler::cycles() - start + (i & 0xfff));
+    }
+  }
+  Bench::Sample s = timer.stop(frames);
+
+  Profiler::reset();
+  return s;
+}
+
+/**
+ * Prints a result as a row of the table and writes it to out as a JSON
+ * object, followed by end.
+ */
+void report(FILE* out,
+            const char* name,
+            const Bench::Sample& s,
+            const char* end) {
+  double nsFrame = Bench::perFrame(s.nanos, s.frames);
+  double nsPixel = nsFrame / LED_COUNT;
+  double allocs = Bench::perFrame(s.allocations, s.frames);
+
+  fprintf(stderr, "[bench] %-16s %12.1f %10.2f %12.2f\n", name, nsFrame,
+          nsPixel, allocs);
+  fprintf(out,
+          "{\"name\": \"%s\", \"ns_per_frame\": %.1f, \"ns_per_pixel\": %.3f, "
+          "\"allocs_per_frame\": %.3f}%s\n",
+          name, nsFrame, nsPixel, allocs, end);
+}
+
+int main(int argc, char** argv) {
+  uint32_t frames = (argc > 1) ? atol(argv[1]) : 2000;
+  FILE* out = Bench::openOutput((argc > 2) ? argv[2] : nullptr);
+
+  Serial.setOutput(nullptr);
+  Clock::useVirtual();
+  Profiler::setup();
+
+  lightState.initialize();
+  effects.setup(leds, LED_COUNT, lightState.getCurrentState());
+
+  fprintf(stderr, "[bench] %i leds, %i fps, %u frames per effect\n",
+          LED_COUNT, FPS, frames);
+  fprintf(stderr, "[bench] %-16s %12s %10s %12s\n", "effect", "ns/frame",
+          "ns/pixel", "allocs/frame");
+
+  fprintf(out, "{\n  \"led_count\": %i,\n  \"fps\": %i,\n", LED_COUNT, FPS);
+  fprintf(out, "  \"frames\": %u,\n  \"effects\": [\n", frames);
+
+  uint8_t n = sizeof(cases) / sizeof(cases[0]);
+  for (uint8_t c = 0; c < n; c++) {
+    fprintf(out, "    ");
+    report(out, cases[c].name, benchEffect(cases[c].effect, frames),
+           (c < n - 1) ? "," : "");
+  }
+
+  fprintf(out, "  ],\n  \"layers\": [\n");
+
+  n = sizeof(layerCases) / sizeof(layerCases[0]);
+  for (uint8_t c = 0; c < n; c++) {
+    fprintf(out, "    ");
+    report(out, layerCases[c].name, benchLayer(layerCases[c], frames),
+           (c < n - 1) ? "," : "");
+  }
+  fprintf(out, "  ],\n");
+
+  fprintf(out, "  \"commands\": ");
+  report(out, "(commands)", benchCommands(frames), ",");
+  fprintf(out, "  \"crossfade\": ");
+  report(out, "(crossfade)", benchCrossfade(frames), ",");
+  fprintf(out, "  \"hdr_output\": ");
+  report(out, "(hdr output)", benchHdrOutput(frames), ",");
+
+  Bench::Sample s = benchProfiler(frames);
+  double nsFrame = Bench::perFrame(s.nanos, s.frames);
+  double budget = nsFrame / (Effects::FRAME_MICROS * 10.0);
+
+  fprintf(stderr, "[bench] %-16s %12.1f %9.3f%% of frame\n", "(profiler)",
+          nsFrame, budget);
+  fprintf(out,
+          "  \"profiler\": {\"ns_per_frame\": %.1f, "
+          "\"frame_budget_percent\": %.4f}\n}\n",
+          nsFrame, budget);
+  Bench::closeOutput(out);
+
+  return 0;
+}
@@ -0,0 +1,160 @@
+/*
+ * RealFFT against arduinoFFT.
+ *
+ * Transforms the same test signals with the single precision real FFT used
+ * by Esp32FFT and with the double precision arduinoFFT it replaced: Hamming
+ * window, forward transform, magnitudes. Reports the largest difference of
+ * any bin relative to the loudest bin and the time per transform. Fails when
+ * a signal differs by more than MAX_ERROR.
+ *
+ * The host has a double precision FPU, the ESP32 does not, so the speedup on
+ * the board is well above the one measured here.
+ *
+ *   pio run -e native-bench-fft
+ *   .pio/build/native-bench-fft/program [transforms] [output.json]
+ */
+#include <Arduino.h>
+#include <FastLED.h>
+
+#include <Bench.h>
+#include <RealFFT.h>
+#include <arduinoFFT.h>
+#include <math.h>
+
+#define SAMPLING_FREQUENCY 40000
+#define MAX_ERROR 1e-4
+
+typedef enum { Silence, Tone, Chord, Noise, Sweep, Square } Signal;
+
+const char* SIGNAL_NAMES[] = {"silence", "tone", "chord",
+                              "noise",   "sweep", "square"};
+
+static uint16_t input[RealFFT::SIZE];
+static float samples[RealFFT::SIZE];
+static float magnitudes[RealFFT::BINS];
+static double vReal[RealFFT::SIZE];
+static double vImag[RealFFT::SIZE];
+
+/** 12 bit ADC samples around the midpoint, like the microphone gives. */
+void generate(Signal signal) {
+  for (uint16_t i = 0; i < RealFFT::SIZE; i++) {
+    double t = static_cast<double>(i) / SAMPLING_FREQUENCY;
+    double v = 0;
+    switch (signal) {
+      case Silence:
+        break;
+      case Tone:
+        v = 1500 * sin(2 * M_PI * 440 * t);
+        break;
+      case Chord:
+        v = 800 * sin(2 * M_PI * 110 * t) + 500 * sin(2 * M_PI * 1320 * t) +
+            300 * sin(2 * M_PI * 7040 * t);
+        break;
+      case Noise:
+        v = static_cast<int16_t>(random16(4000)) - 2000;
+        break;
+      case Sweep:
+        v = 1800 * sin(2 * M_PI * (50 + 9000 * t) * t);
+        break;
+      case Square:
+        v = ((i / 40) & 1) ? 2047 : -2048;
+        break;
+    }
+    input[i] = constrain(2048 + static_cast<int>(v), 0, 4095);
+  }
+}
+
+void realFFT(RealFFT::Transform& fft) {
+  for (uint16_t i = 0; i < RealFFT::SIZE; i++) {
+    samples[i] = input[i];
+  }
+  fft.magnitudes(samples, magnitudes);
+}
+
+void reference(arduinoFFT& fft) {
+  for (uint16_t i = 0; i < RealFFT::SIZE; i++) {
+    vReal[i] = input[i];
+    vImag[i] = 0;
+  }
+  fft.Windowing(vReal, RealFFT::SIZE, FFT_WIN_TYP_HAMMING, FFT_FORWARD);
+  fft.Compute(vReal, vImag, RealFFT::SIZE, FFT_FORWARD);
+  fft.ComplexToMagnitude(vReal, vImag, RealFFT::SIZE);
+}
+
+/** Largest difference of a bin, relative to the loudest reference bin. */
+double relativeError() {
+  double peak = 1;
+  double worst = 0;
+  for (uint16_t k = 0; k < RealFFT::BINS; k++) {
+    peak = max(peak, vReal[k]);
+    worst = max(worst, fabs(magnitudes[k] - vReal[k]));
+  }
+  return worst / peak;
+}
+
+int main(int argc, char** argv) {
+  uint32_t transforms = (argc > 1) ? atol(argv[1]) : 2000;
+  FILE* out = Bench::openOutput((argc > 2) ? argv[2] : nullptr);
+  Serial.setOutput(nullptr);
+  random16_set_seed(1337);
+
+  RealFFT::Transform fft;
+  arduinoFFT referenceFFT;
+
+  fprintf(stderr, "[bench] %u point transforms, %u per signal\n",
+          RealFFT::SIZE, transforms);
+  fprintf(stderr, "[bench] %-8s %12s %12s %12s %7s\n", "signal", "error",
+          "realfft ns", "arduino ns", "result");
+  fprintf(out, "{\n  \"size\": %u,\n  \"transforms\": %u,\n  \"signals\": [\n",
+          RealFFT::SIZE, transforms);
+
+  uint32_t failures = 0;
+  uint8_t n = sizeof(SIGNAL_NAMES) / sizeof(SIGNAL_NAMES[0]);
+  for (uint8_t s = 0; s < n; s++) {
+    generate(static_cast<Signal>(s));
+    realFFT(fft);
+    reference(referenceFFT);
+    double error = relativeError();
+
+    Bench::Timer timer;
+    timer.start();
+    for (uint32_t i = 0; i < transforms; i++) {
+      realFFT(fft);
+    }
+    double nsReal = Bench::perFrame(timer.stop(transforms).nanos, transforms);
+
+    timer.start();
+    for (uint32_t i = 0; i < transforms; i++) {
+      reference(referenceFFT);
+    }
+    double nsReference =
+        Bench::perFrame(timer.stop(transforms).nanos, transforms);
+
+    bool pass = error <= MAX_ERROR;
+    if (!pass)
+      failures++;
+
+    fprintf(stderr, "[bench] %-8s %12.2e %12.0f %12.0f %7s\n",
+            SIGNAL_NAMES[s], error, nsReal, nsReference,
+            pass ? "ok" : "FAILED");
+    fprintf(out,
+            "    {\"name\": \"%s\", \"error\": %.3e, \"realfft_ns\": %.0f, "
+            "\"arduinofft_ns\": %.0f, \"pass\": %s}%s\n",
+            SIGNAL_NAMES[s], error, nsReal, nsReference,
+            pass ? "true" : "false", (s < n - 1) ? "," : "");
+  }
+
+  // Buffers a transform works on, the shared tables not counted.
+  uint32_t realBytes = sizeof(samples) + sizeof(magnitudes);
+  uint32_t referenceBytes = sizeof(vReal) + sizeof(vImag);
+  fprintf(stderr, "[bench] buffers: realfft %u bytes, arduinofft %u bytes\n",
+          realBytes, referenceBytes);
+  fprintf(stderr, "[bench] fft %s\n", failures ? "FAILED" : "ok");
+  fprintf(out,
+          "  ],\n  \"realfft_bytes\": %u,\n  \"arduinofft_bytes\": %u,\n"
+          "  \"pass\": %s\n}\n",
+          realBytes, referenceBytes, failures ? "false" : "true");
+  Bench::closeOutput(out);
+
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,154 @@
+/*
+ * Frame rate governor simulation.
+ *
+ * Feeds Governor::Controller the frame costs of made up workloads, on a
+ * simulated clock, and checks the level it settles on. A frame costs its
+ * render time at full quality scaled down for the cheaper qualities, plus a
+ * network pass. Scenarios cover a light load, loads that need a lower rate
+ * or quality, a load that goes away again, one that sits right at a
+ * threshold and one that only fits at Reduced quality, where every step up
+ * overruns. Neither may make the governor hunt. The last renders quickly,
+ * but its strip takes longer than a period to show on the output core, so
+ * only the dropped frames tell. Fails when a scenario ends on the wrong
+ * level or changes level too often.
+ *
+ *   pio run -e native-bench-governor
+ *   .pio/build/native-bench-governor/program [seconds] [output.json]
+ */
+#include <Arduino.h>
+#include <FastLED.h>
+
+#include <Bench.h>
+#include <Governor.h>
+
+// Costs are given in per mille of the frame period, so the scenarios hold
+// at any FPS.
+#define PERIOD_MICROS (1000000 / FPS)
+#define MICROS(permille) ((permille) * PERIOD_MICROS / 1000)
+
+// Network pass per frame.
+#define NETWORK_MICROS MICROS(36)
+
+// Render cost of Reduced and Minimal quality in percent of Full.
+const uint8_t QUALITY_COST[] = {100, 70, 50};
+
+typedef struct Scenario {
+  const char* name;
+  uint32_t first;  // render + show at full quality, first half, per mille
+  uint32_t second;  // and second half of the run
+  uint32_t jitter;
+  uint32_t show;  // on the output core, per mille
+  uint8_t expectedLevel;
+  uint8_t maxChanges;  // in a minute
+} Scenario;
+
+const Scenario scenarios[] = {
+    {"light", 360, 360, 60, 0, 0, 0},
+    {"heavy", 1320, 1320, 60, 0, 2, 2},
+    {"overloaded", 4800, 4800, 240, 0, 5, 5},
+    {"burst", 3600, 360, 60, 0, 0, 8},
+    {"borderline", 828, 828, 180, 0, 1, 2},
+    {"quality edge", 1776, 1776, 60, 0, 3, 11},
+    {"output bound", 240, 240, 60, 1500, 2, 10}};
+
+uint32_t frameCost(const Scenario& s, Governor::Quality q, uint64_t time,
+                   uint64_t duration) {
+  uint32_t render = MICROS((time < duration / 2) ? s.first : s.second);
+  uint32_t jitter = s.jitter ? random16() % MICROS(s.jitter) : 0;
+  return (render + jitter) * QUALITY_COST[q] / 100;
+}
+
+/**
+ * Runs one scenario for the given simulated time, returns the number of
+ * level changes.
+ */
+uint32_t simulate(const Scenario& s, Governor::Controller& governor,
+                  uint32_t seconds) {
+  uint64_t duration = seconds * 1000000ull;
+  uint64_t time = 0;
+  uint64_t outputFree = 0;
+  uint32_t changes = 0;
+
+  while (time < duration) {
+    uint32_t period = governor.getFrameMicros();
+    uint32_t cost = frameCost(s, governor.getQuality(), time, duration);
+
+    // Handed to the output core once rendered, dropped while it is busy.
+    bool dropped = time + cost < outputFree;
+    if (!dropped)
+      outputFree = time + cost + MICROS(s.show);
+
+    governor.recordNetwork(NETWORK_MICROS);
+    if (governor.recordFrame(cost, dropped))
+      changes++;
+
+    // Frames that overrun push the next one back.
+    time += (cost + NETWORK_MICROS > period) ? cost + NETWORK_MICROS : period;
+  }
+  return changes;
+}
+
+int main(int argc, char** argv) {
+  // The burst needs up to ten seconds to climb back once its load is gone.
+  uint32_t seconds = max((argc > 1) ? atol(argv[1]) : 60, 20L);
+  FILE* out = Bench::openOutput((argc > 2) ? argv[2] : nullptr);
+
+  Serial.setOutput(nullptr);
+  random16_set_seed(1337);
+
+  fprintf(stderr, "[bench] %i fps, %u simulated s per scenario\n", FPS,
+          seconds);
+  fprintf(stderr, "[bench] %-12s %5s %8s %6s %8s %8s %8s %7s\n", "scenario",
+          "fps", "quality", "load", "overruns", "dropped", "changes", "result");
+  fprintf(out, "{\n  \"fps\": %i,\n  \"seconds\": %u,\n  \"scenarios\": [\n",
+          FPS, seconds);
+
+  // A failed step up waits twice as long before it is tried again, so every
+  // doubling of the run may add one more try: a step up and back.
+  uint32_t retries = 0;
+  for (uint32_t s = 60; s < seconds; s *= 2) {
+    retries++;
+  }
+  uint32_t failures = 0;
+  uint8_t n = sizeof(scenarios) / sizeof(scenarios[0]);
+  for (uint8_t c = 0; c < n; c++) {
+    Governor::Controller governor;
+    uint32_t changes = simulate(scenarios[c], governor, seconds);
+    const Governor::Telemetry& t = governor.getTelemetry();
+
+    bool pass = t.level == scenarios[c].expectedLevel &&
+                changes <= scenarios[c].maxChanges + 2 * retries;
+    if (!pass)
+      failures++;
+
+    fprintf(stderr, "[bench] %-12s %5u %8s %5u%% %8u %8u %8u %7s\n",
+            scenarios[c].name, t.fps, governor.getQualityName(t.quality),
+            t.load, t.overruns, t.dropped, changes, pass ? "ok" : "FAILED");
+    fprintf(out,
+            "    {\"name\": \"%s\", \"fps\": %u, \"quality\": \"%s\", "
+            "\"load\": %u, \"overruns\": %u, \"dropped\": %u, "
+            "\"changes\": %u, \"pass\": %s}%s\n",
+            scenarios[c].name, t.fps, governor.getQualityName(t.quality),
+            t.load, t.overruns, t.dropped, changes, pass ? "true" : "false",
+            (c < n - 1) ? "," : "");
+  }
+
+  // What the bookkeeping costs the loop per frame.
+  Governor::Controller governor;
+  uint32_t frames = 1000000;
+  Bench::Timer timer;
+  timer.start();
+  for (uint32_t i = 0; i < frames; i++) {
+    governor.recordNetwork(NETWORK_MICROS);
+    governor.recordFrame(MICROS(360) + (i & 0x3ff));
+  }
+  double nsFrame = Bench::perFrame(timer.stop(frames).nanos, frames);
+
+  fprintf(stderr, "[bench] bookkeeping %.1f ns/frame\n", nsFrame);
+  fprintf(stderr, "[bench] governor %s\n", failures ? "FAILED" : "ok");
+  fprintf(out, "  ],\n  \"ns_per_frame\": %.1f,\n  \"pass\": %s\n}\n",
+          nsFrame, failures ? "false" : "true");
+  Bench::closeOutput(out);
+
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,208 @@
+/*
+ * Pixel kernel benchmark and equivalence check.
+ *
+ * Runs every kernel in lib/Pixels and its Pixels::Scalar reference on the
+ * same random buffers, for strip lengths that leave every possible tail of
+ * bytes after the last whole word, and fails when any output pixel or
+ * returned flag differs. scale() and fadeToward() are also checked against
+ * FastLED's nscale8() and the nblendU8TowardU8() fade Effects used before,
+ * multiply() against scale8() of every channel, blended in with blend8().
+ * Then both versions are timed on a LED_COUNT strip.
+ *
+ *   pio run -e native-bench-pixels
+ *   .pio/build/native-bench-pixels/program [iterations] [output.json]
+ */
+#include <Arduino.h>
+#include <FastLED.h>
+
+#include <Bench.h>
+#include <Pixels.h>
+#include <string.h>
+
+// Longest strip the equivalence check runs.
+#define CHECK_LEDS 150
+
+typedef bool (*Kernel)(CRGB* dst, const CRGB* src, uint16_t n, uint8_t param);
+
+typedef struct KernelCase {
+  const char* name;
+  Kernel fast;
+  Kernel scalar;
+} KernelCase;
+
+// Solid color the color kernels work against.
+const CRGB color(200, 13, 97);
+
+#define CASE(NAME, CALL)                                                     \
+  {                                                                          \
+    NAME,                                                                    \
+        [](CRGB* dst, const CRGB* src, uint16_t n, uint8_t param) -> bool {  \
+          using namespace Pixels;                                            \
+          return CALL;                                                       \
+        },                                                                   \
+        [](CRGB* dst, const CRGB* src, uint16_t n, uint8_t param) -> bool {  \
+          using namespace Pixels::Scalar;                                    \
+          return CALL;                                                       \
+        }                                                                    \
+  }
+
+const KernelCase cases[] = {
+    CASE("fill", (fill(dst, n, color), false)),
+    CASE("scale", scale(dst, n, param)),
+    CASE("fadeToward", fadeToward(dst, n, color, param)),
+    CASE("lerp", (lerp(dst, src, n, param + 1), false)),
+    CASE("lerpToward", (lerpToward(dst, src, n, color, param + 1), false)),
+    CASE("add", (add(dst, src, n, param), false)),
+    CASE("max", (max(dst, src, n, param), false)),
+    CASE("alpha", (alpha(dst, src, n, param), false)),
+    CASE("multiply", (multiply(dst, src, n, param), false))};
+
+alignas(4) CRGB src[CHECK_LEDS > LED_COUNT ? CHECK_LEDS : LED_COUNT];
+alignas(4) CRGB fast[CHECK_LEDS > LED_COUNT ? CHECK_LEDS : LED_COUNT];
+alignas(4) CRGB scalar[CHECK_LEDS > LED_COUNT ? CHECK_LEDS : LED_COUNT];
+
+void randomize(CRGB* pixels, uint16_t n) {
+  for (uint16_t i = 0; i < n; i++) {
+    // Plenty of 0, 255 and equal channels, where the carries go wrong.
+    for (uint8_t c = 0; c < 3; c++) {
+      uint8_t r = random8();
+      pixels[i].raw[c] = (r < 32) ? 0 : (r < 64) ? 255 : (r < 80) ? color.raw[c]
+                                                                    : random8();
+    }
+  }
+}
+
+/**
+ * Compares fast and scalar output of one kernel, returns the number of
+ * mismatching runs.
+ */
+uint32_t check(const KernelCase& k, uint32_t runs) {
+  uint32_t failures = 0;
+  for (uint32_t run = 0; run < runs; run++) {
+    uint16_t n = 1 + (run % CHECK_LEDS);
+    uint8_t param = random8();
+    randomize(src, n);
+    randomize(fast, n);
+    // Some runs start on the color so the done flags get tested both ways.
+    if (run % 7 == 0)
+      fill_solid(fast, n, color);
+    memcpy(scalar, fast, n * sizeof(CRGB));
+
+    bool a = k.fast(fast, src, n, param);
+    bool b = k.scalar(scalar, src, n, param);
+    if (a != b || memcmp(fast, scalar, n * sizeof(CRGB)) != 0)
+      failures++;
+  }
+  return failures;
+}
+
+/**
+ * The reference itself against the FastLED and Effects code it replaces.
+ */
+uint32_t checkReplaced(uint32_t runs) {
+  uint32_t failures = 0;
+  for (uint32_t run = 0; run < runs; run++) {
+    uint16_t n = 1 + (run % CHECK_LEDS);
+    uint8_t param = random8();
+    randomize(fast, n);
+    memcpy(scalar, fast, n * sizeof(CRGB));
+
+    Pixels::Scalar::scale(fast, n, param);
+    nscale8(scalar, n, param);
+    if (memcmp(fast, scalar, n * sizeof(CRGB)) != 0)
+      failures++;
+
+    Pixels::Scalar::fadeToward(fast, n, color, param);
+    for (uint16_t i = 0; i < n; i++) {
+      for (uint8_t c = 0; c < 3; c++) {
+        uint8_t& cur = scalar[i].raw[c];
+        uint8_t target = color.raw[c];
+        if (cur < target)
+          cur += scale8_video(target - cur, param);
+        else if (cur > target)
+          cur -= scale8_video(cur - target, param);
+      }
+    }
+    if (memcmp(fast, scalar, n * sizeof(CRGB)) != 0)
+      failures++;
+
+    // Exact at full opacity, blend8() rounds its own way, so within one
+    // below that.
+    uint8_t opacity = (run % 2) ? 255 : param;
+    randomize(src, n);
+    memcpy(scalar, fast, n * sizeof(CRGB));
+    Pixels::Scalar::multiply(fast, src, n, opacity);
+    int16_t slack = (opacity == 255) ? 0 : 1;
+    bool wrong = false;
+    for (uint16_t i = 0; i < n; i++) {
+      for (uint8_t c = 0; c < 3; c++) {
+        uint8_t cur = scalar[i].raw[c];
+        uint8_t product = scale8(cur, src[i].raw[c]);
+        uint8_t expected =
+            (opacity == 255) ? product : blend8(cur, product, opacity);
+        if (abs(fast[i].raw[c] - expected) > slack)
+          wrong = true;
+      }
+    }
+    if (wrong)
+      failures++;
+  }
+  return failures;
+}
+
+Bench::Sample time(Kernel kernel, CRGB* dst, uint32_t iterations) {
+  Bench::Timer timer;
+  timer.start();
+  for (uint32_t i = 0; i < iterations; i++) {
+    kernel(dst, src, LED_COUNT, 200);
+  }
+  return timer.stop(iterations);
+}
+
+int main(int argc, char** argv) {
+  uint32_t iterations = (argc > 1) ? atol(argv[1]) : 20000;
+  FILE* out = Bench::openOutput((argc > 2) ? argv[2] : nullptr);
+
+  random16_set_seed(1337);
+
+  fprintf(stderr, "[bench] %i leds, %u iterations\n", LED_COUNT, iterations);
+  fprintf(stderr, "[bench] %-12s %10s %10s %8s %9s\n", "kernel", "words ns",
+          "scalar ns", "speedup", "failures");
+  fprintf(out, "{\n  \"led_count\": %i,\n  \"kernels\": [\n", LED_COUNT);
+
+  uint32_t total = 0;
+  uint8_t n = sizeof(cases) / sizeof(cases[0]);
+  for (uint8_t c = 0; c < n; c++) {
+    uint32_t failures = check(cases[c], 20000);
+    total += failures;
+
+    randomize(src, LED_COUNT);
+    randomize(fast, LED_COUNT);
+    memcpy(scalar, fast, sizeof(fast));
+    double nsFast =
+        Bench::perFrame(time(cases[c].fast, fast, iterations).nanos, iterations);
+    double nsScalar = Bench::perFrame(
+        time(cases[c].scalar, scalar, iterations).nanos, iterations);
+
+    fprintf(stderr, "[bench] %-12s %10.1f %10.1f %7.1fx %9u\n", cases[c].name,
+            nsFast, nsScalar, nsScalar / nsFast, failures);
+    fprintf(out,
+            "    {\"name\": \"%s\", \"words_ns\": %.1f, \"scalar_ns\": %.1f, "
+            "\"failures\": %u}%s\n",
+            cases[c].name, nsFast, nsScalar, failures, (c < n - 1) ? "," : "");
+  }
+
+  uint32_t replaced = checkReplaced(20000);
+  total += replaced;
+
+  fprintf(stderr,
+          "[bench] against nscale8, nblendU8TowardU8 and scale8: %u failures\n",
+          replaced);
+  fprintf(stderr, "[bench] equivalence %s\n", total ? "FAILED" : "ok");
+
+  fprintf(out, "  ],\n  \"replaced_failures\": %u,\n  \"pass\": %s\n}\n",
+          replaced, total ? "false" : "true");
+  Bench::closeOutput(out);
+
+  return total ? 1 : 0;
+}
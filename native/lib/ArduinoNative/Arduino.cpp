@@ -0,0 +1,109 @@
+#include "Arduino.h"
+
+#include <stdarg.h>
+
+#include <chrono>
+#include <thread>
+
+HardwareSerial Serial;
+
+static const std::chrono::steady_clock::time_point startTime =
+    std::chrono::steady_clock::now();
+
+static uint16_t defaultAnalogSource(uint8_t pin) {
+  return 2048;
+}
+
+static AnalogReadSource analogSource = defaultAnalogSource;
+
+unsigned long millis() {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(
+             std::chrono::steady_clock::now() - startTime)
+      .count();
+}
+
+unsigned long micros() {
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+             std::chrono::steady_clock::now() - startTime)
+      .count();
+}
+
+void delay(unsigned long ms) {
+  std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+void delayMicroseconds(unsigned int us) {
+  std::this_thread::sleep_for(std::chrono::microseconds(us));
+}
+
+long map(long x, long in_min, long in_max, long out_min, long out_max) {
+  return (x - in_min) * (out_max - out_min) / (in_max - in_min) + out_min;
+}
+
+long random(long howbig) {
+  if (howbig == 0)
+    return 0;
+  return ::random() % howbig;
+}
+
+long random(long howsmall, long howbig) {
+  if (howsmall >= howbig)
+    return howsmall;
+  return random(howbig - howsmall) + howsmall;
+}
+
+void randomSeed(unsigned long seed) {
+  if (seed != 0)
+    srandom(seed);
+}
+
+// ========================================================================
+// Analog input
+// ========================================================================
+uint16_t analogRead(uint8_t pin) {
+  return analogSource(pin);
+}
+
+void analogReadResolution(uint8_t bits) {}
+void analogSetCycles(uint8_t cycles) {}
+void analogSetSamples(uint8_t samples) {}
+void analogSetAttenuation(adc_attenuation_t attenuation) {}
+
+void setAnalogReadSource(AnalogReadSource source) {
+  analogSource = (source != nullptr) ? source : defaultAnalogSource;
+}
+
+// ========================================================================
+// Serial
+// ========================================================================
+size_t HardwareSerial::print(const char* str) {
+  return (_out != nullptr) ? fputs(str, _out) : 0;
+}
+
+size_t HardwareSerial::print(long n) {
+  return (_out != nullptr) ? fprintf(_out, "%ld", n) : 0;
+}
+
+size_t HardwareSerial::println() {
+  return print("\n");
+}
+
+size_t HardwareSerial::println(const char* str) {
+  return print(str) + println();
+}
+
+size_t HardwareSerial::println(long n) {
+  return print(n) + println();
+}
+
+size_t HardwareSerial::printf(const char* format, ...) {
+  if (_out == nullptr)
+    return 0;
+
+  va_list args;
+  va_start(args, format);
+  int written = vfprintf(_out, format, args);
+  va_end(args);
+
+  return (written > 0) ? written : 0;
+}
@@ -0,0 +1,100 @@
+/**
+ * Minimal Arduino core replacement used by the native (host) build.
+ *
+ * Only provides what the libraries in lib/ actually use so that Effects,
+ * LightState and Esp32FFT can be compiled and run on Linux.
+ */
+#ifndef ARDUINO_NATIVE_H
+#define ARDUINO_NATIVE_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <cmath>
+#include <string>
+
+typedef uint8_t byte;
+typedef bool boolean;
+typedef unsigned long ulong;
+
+#ifndef PI
+#define PI 3.1415926535897932384626433832795
+#endif
+#define TWO_PI 6.283185307179586476925286766559
+#define DEG_TO_RAD 0.017453292519943295769236907684886
+
+#define constrain(amt, low, high) \
+  ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+#define sq(x) ((x) * (x))
+
+using std::max;
+using std::min;
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+
+long map(long x, long in_min, long in_max, long out_min, long out_max);
+long random(long howbig);
+long random(long howsmall, long howbig);
+void randomSeed(unsigned long seed);
+
+// ========================================================================
+// Analog input. Samples come from a replaceable source so FFT code can be
+// fed synthetic signals on the host.
+// ========================================================================
+typedef enum { ADC_0db, ADC_2_5db, ADC_6db, ADC_11db } adc_attenuation_t;
+typedef uint16_t (*AnalogReadSource)(uint8_t pin);
+
+uint16_t analogRead(uint8_t pin);
+void analogReadResolution(uint8_t bits);
+void analogSetCycles(uint8_t cycles);
+void analogSetSamples(uint8_t samples);
+void analogSetAttenuation(adc_attenuation_t attenuation);
+void setAnalogReadSource(AnalogReadSource source);
+
+// ========================================================================
+// String
+// ========================================================================
+class String : public std::string {
+ public:
+  String() : std::string() {}
+  String(const char* s) : std::string(s) {}
+  String(const std::string& s) : std::string(s) {}
+  String(int value) : std::string(std::to_string(value)) {}
+  String(unsigned int value) : std::string(std::to_string(value)) {}
+  String(long value) : std::string(std::to_string(value)) {}
+  String(unsigned long value) : std::string(std::to_string(value)) {}
+};
+
+// ========================================================================
+// Serial, writes to stdout. Pass nullptr to setOutput to silence it.
+// ========================================================================
+class HardwareSerial {
+ public:
+  void begin(unsigned long baud) {}
+  void setOutput(FILE* out) { _out = out; }
+
+  size_t print(const char* str);
+  size_t print(const std::string& str) { return print(str.c_str()); }
+  size_t print(int n) { return print(static_cast<long>(n)); }
+  size_t print(long n);
+  size_t println();
+  size_t println(const char* str);
+  size_t println(const std::string& str) { return println(str.c_str()); }
+  size_t println(int n) { return println(static_cast<long>(n)); }
+  size_t println(long n);
+  size_t printf(const char* format, ...)
+      __attribute__((format(printf, 2, 3)));
+
+ private:
+  FILE* _out = stdout;
+};
+
+extern HardwareSerial Serial;
+
+#endif  // ARDUINO_NATIVE_H
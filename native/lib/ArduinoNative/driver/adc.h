@@ -0,0 +1,10 @@
+/**
+ * Placeholder for the ESP-IDF ADC driver header. The analog functions used
+ * by Esp32FFT are declared in Arduino.h of the native build.
+ */
+#ifndef DRIVER_ADC_NATIVE_H
+#define DRIVER_ADC_NATIVE_H
+
+#include <Arduino.h>
+
+#endif  // DRIVER_ADC_NATIVE_H
@@ -0,0 +1,68 @@
+#include "Bench.h"
+
+#include <stdlib.h>
+
+#include <atomic>
+#include <chrono>
+#include <new>
+
+static std::atomic<uint64_t> allocationCounter(0);
+
+void* operator new(size_t size) {
+  allocationCounter++;
+  void* p = malloc(size ? size : 1);
+  if (p == nullptr)
+    throw std::bad_alloc();
+  return p;
+}
+
+void* operator new[](size_t size) {
+  allocationCounter++;
+  void* p = malloc(size ? size : 1);
+  if (p == nullptr)
+    throw std::bad_alloc();
+  return p;
+}
+
+void operator delete(void* p) noexcept {
+  free(p);
+}
+
+void operator delete[](void* p) noexcept {
+  free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+  free(p);
+}
+
+void operator delete[](void* p, size_t) noexcept {
+  free(p);
+}
+
+uint64_t Bench::nanos() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+uint64_t Bench::allocations() {
+  return allocationCounter.load(std::memory_order_relaxed);
+}
+
+FILE* Bench::openOutput(const char* path) {
+  if (path == nullptr || path[0] == '\0')
+    return stdout;
+
+  FILE* out = fopen(path, "w");
+  if (out == nullptr) {
+    fprintf(stderr, "[bench] could not open '%s', using stdout\n", path);
+    return stdout;
+  }
+  return out;
+}
+
+void Bench::closeOutput(FILE* out) {
+  if (out != stdout)
+    fclose(out);
+}
@@ -0,0 +1,76 @@
+/**
+ * Small helpers shared by the host benchmarks: a monotonic nanosecond clock
+ * and a heap allocation counter (global operator new is replaced in
+ * Bench.cpp).
+ */
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+namespace Bench {
+
+uint64_t nanos();
+uint64_t allocations();
+
+typedef struct Sample {
+  uint64_t nanos;
+  uint64_t allocations;
+  uint32_t frames;
+} Sample;
+
+/**
+ * Measures elapsed time and allocations between start() and stop().
+ */
+class Timer {
+ public:
+  void start() {
+    startNanos = nanos();
+    startAllocations = allocations();
+  }
+
+  Sample stop(uint32_t frames) {
+    Sample s;
+    s.nanos = nanos() - startNanos;
+    s.allocations = allocations() - startAllocations;
+    s.frames = frames;
+    return s;
+  }
+
+ private:
+  uint64_t startNanos = 0;
+  uint64_t startAllocations = 0;
+};
+
+inline double perFrame(uint64_t value, uint32_t frames) {
+  return (frames > 0) ? static_cast<double>(value) / frames : 0;
+}
+
+/**
+ * Times body, which does frames of work, rounds times and keeps the fastest
+ * round, the one the rest of the machine got in the way of least.
+ */
+template <typename Body>
+Sample fastest(uint8_t rounds, uint32_t frames, Body body) {
+  Sample best = {UINT64_MAX, 0, frames};
+  Timer timer;
+  for (uint8_t r = 0; r < rounds; r++) {
+    timer.start();
+    body();
+    Sample s = timer.stop(frames);
+    if (s.nanos < best.nanos)
+      best = s;
+  }
+  return best;
+}
+
+/**
+ * Opens the JSON output file, falling back to stdout when no path is given.
+ */
+FILE* openOutput(const char* path);
+void closeOutput(FILE* out);
+
+}  // namespace Bench
+
+#endif  // BENCH_H
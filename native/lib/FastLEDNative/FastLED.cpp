@@ -0,0 +1,396 @@
+#include "FastLED.h"
+
+CFastLED FastLED;
+uint16_t rand16seed = 1337;
+
+// ========================================================================
+// lib8tion
+// ========================================================================
+int16_t sin16(uint16_t theta) {
+  static const uint16_t base[] = {0,     6393,  12539, 18204,
+                                  23170, 27245, 30273, 32137};
+  static const uint8_t slope[] = {49, 48, 44, 38, 31, 23, 14, 4};
+
+  uint16_t offset = (theta & 0x3FFF) >> 3;  // 0..2047
+  if (theta & 0x4000)
+    offset = 2047 - offset;
+
+  uint8_t section = offset / 256;  // 0..7
+  uint16_t b = base[section];
+  uint8_t m = slope[section];
+
+  uint8_t secoffset8 = static_cast<uint8_t>(offset) / 2;
+
+  uint16_t mx = m * secoffset8;
+  int16_t y = mx + b;
+
+  if (theta & 0x8000)
+    y = -y;
+
+  return y;
+}
+
+uint8_t sin8(uint8_t theta) {
+  static const uint8_t b_m16_interleave[] = {0, 49, 49, 41, 90, 27, 117, 10};
+
+  uint8_t offset = theta;
+  if (theta & 0x40)
+    offset = 255 - offset;
+  offset &= 0x3F;  // 0..63
+
+  uint8_t secoffset = offset & 0x0F;  // 0..15
+  if (theta & 0x40)
+    secoffset++;
+
+  uint8_t section = offset >> 4;  // 0..3
+  const uint8_t* p = b_m16_interleave + (section * 2);
+  uint8_t b = p[0];
+  uint8_t m16 = p[1];
+
+  uint8_t mx = (m16 * secoffset) >> 4;
+
+  int8_t y = mx + b;
+  if (theta & 0x80)
+    y = -y;
+
+  y += 128;
+  return y;
+}
+
+// ========================================================================
+// Color conversion
+// ========================================================================
+void hsv2rgb_rainbow(const CHSV& hsv, CRGB& rgb) {
+  const uint8_t K255 = 255;
+  const uint8_t K171 = 171;
+  const uint8_t K170 = 170;
+  const uint8_t K85 = 85;
+
+  uint8_t hue = hsv.hue;
+  uint8_t sat = hsv.sat;
+  uint8_t val = hsv.val;
+
+  uint8_t offset8 = (hue & 0x1F) << 3;  // 0..248
+  uint8_t third = scale8(offset8, (256 / 3));
+  uint8_t twothirds = scale8(offset8, ((256 * 2) / 3));
+
+  uint8_t r, g, b;
+
+  if (!(hue & 0x80)) {
+    if (!(hue & 0x40)) {
+      if (!(hue & 0x20)) {
+        // 000 R -> O
+        r = K255 - third;
+        g = third;
+        b = 0;
+      } else {
+        // 001 O -> Y
+        r = K171;
+        g = K85 + third;
+        b = 0;
+      }
+    } else {
+      if (!(hue & 0x20)) {
+        // 010 Y -> G
+        r = K171 - twothirds;
+        g = K170 + third;
+        b = 0;
+      } else {
+        // 011 G -> A
+        r = 0;
+        g = K255 - third;
+        b = third;
+      }
+    }
+  } else {
+    if (!(hue & 0x40)) {
+      if (!(hue & 0x20)) {
+        // 100 A -> B
+        r = 0;
+        g = K171 - twothirds;
+        b = K85 + twothirds;
+      } else {
+        // 101 B -> P
+        r = third;
+        g = 0;
+        b = K255 - third;
+      }
+    } else {
+      if (!(hue & 0x20)) {
+        // 110 P -- K
+        r = K85 + third;
+        g = 0;
+        b = K171 - third;
+      } else {
+        // 111 K -> R
+        r = K170 + third;
+        g = 0;
+        b = K85 - third;
+      }
+    }
+  }
+
+  if (sat != 255) {
+    if (sat == 0) {
+      r = 255;
+      b = 255;
+      g = 255;
+    } else {
+      uint8_t desat = 255 - sat;
+      desat = scale8_video(desat, desat);
+
+      uint8_t satscale = 255 - desat;
+      if (r)
+        r = scale8(r, satscale) + 1;
+      if (g)
+        g = scale8(g, satscale) + 1;
+      if (b)
+        b = scale8(b, satscale) + 1;
+
+      r += desat;
+      g += desat;
+      b += desat;
+    }
+  }
+
+  if (val != 255) {
+    val = scale8_video(val, val);
+    if (val == 0) {
+      r = 0;
+      g = 0;
+      b = 0;
+    } else {
+      if (r)
+        r = scale8(r, val) + 1;
+      if (g)
+        g = scale8(g, val) + 1;
+      if (b)
+        b = scale8(b, val) + 1;
+    }
+  }
+
+  rgb.r = r;
+  rgb.g = g;
+  rgb.b = b;
+}
+
+// ========================================================================
+// Fill and fade
+// ========================================================================
+void fill_solid(CRGB* leds, int numToFill, const CRGB& color) {
+  for (int i = 0; i < numToFill; i++) {
+    leds[i] = color;
+  }
+}
+
+void fill_rainbow(CRGB* pFirstLED,
+                  int numToFill,
+                  uint8_t initialhue,
+                  uint8_t deltahue) {
+  CHSV hsv(initialhue, 255, 240);
+  for (int i = 0; i < numToFill; i++) {
+    pFirstLED[i] = hsv;
+    hsv.hue += deltahue;
+  }
+}
+
+void nscale8(CRGB* leds, uint16_t num_leds, uint8_t scale) {
+  for (uint16_t i = 0; i < num_leds; i++) {
+    leds[i].nscale8(scale);
+  }
+}
+
+void fadeToBlackBy(CRGB* leds, uint16_t num_leds, uint8_t fadeBy) {
+  nscale8(leds, num_leds, 255 - fadeBy);
+}
+
+void fill_gradient_RGB(CRGB* leds,
+                       uint16_t startpos,
+                       CRGB startcolor,
+                       uint16_t endpos,
+                       CRGB endcolor) {
+  if (endpos < startpos) {
+    uint16_t t = endpos;
+    CRGB tc = endcolor;
+    endcolor = startcolor;
+    endpos = startpos;
+    startpos = t;
+    startcolor = tc;
+  }
+
+  saccum87 rdistance87 = (endcolor.r - startcolor.r) * 128;
+  saccum87 gdistance87 = (endcolor.g - startcolor.g) * 128;
+  saccum87 bdistance87 = (endcolor.b - startcolor.b) * 128;
+
+  uint16_t pixeldistance = endpos - startpos;
+  int16_t divisor = pixeldistance ? pixeldistance : 1;
+
+  saccum87 rdelta87 = (rdistance87 / divisor) * 2;
+  saccum87 gdelta87 = (gdistance87 / divisor) * 2;
+  saccum87 bdelta87 = (bdistance87 / divisor) * 2;
+
+  accum88 r88 = startcolor.r << 8;
+  accum88 g88 = startcolor.g << 8;
+  accum88 b88 = startcolor.b << 8;
+
+  for (uint16_t i = startpos; i <= endpos; i++) {
+    leds[i] = CRGB(r88 >> 8, g88 >> 8, b88 >> 8);
+    r88 += rdelta87;
+    g88 += gdelta87;
+    b88 += bdelta87;
+  }
+}
+
+// ========================================================================
+// Palettes
+// ========================================================================
+const TProgmemRGBPalette16 PartyColors_p = {
+    0x5500AB, 0x84007C, 0xB5004B, 0xE5001B, 0xE81700, 0xB84700,
+    0xAB7700, 0xABAB00, 0xAB5500, 0xDD2200, 0xF2000E, 0xC2003E,
+    0x8F0071, 0x5F00A1, 0x2F00D0, 0x0007F9};
+
+DEFINE_GRADIENT_PALETTE(Rainbow_gp){
+    0,   255, 0,   0,   32,  171, 85,  0,   64,  171, 171, 0,
+    96,  0,   255, 0,   128, 0,   171, 85,  160, 0,   0,   255,
+    192, 85,  0,   171, 224, 171, 0,   85,  255, 255, 0,   0};
+
+CRGBPalette16::CRGBPalette16(TProgmemRGBGradientPalette_bytes progpal) {
+  // Count entries first, the sparse slot handling depends on it.
+  uint16_t count = 0;
+  for (const uint8_t* p = progpal;; p += 4) {
+    count++;
+    if (p[0] == 255)
+      break;
+  }
+
+  int8_t lastSlotUsed = -1;
+
+  const uint8_t* progent = progpal;
+  CRGB rgbstart(progent[1], progent[2], progent[3]);
+  int indexstart = 0;
+
+  while (indexstart < 255) {
+    progent += 4;
+    int indexend = progent[0];
+    CRGB rgbend(progent[1], progent[2], progent[3]);
+
+    int istart = indexstart / 16;
+    int iend = indexend / 16;
+
+    if (count < 16) {
+      if ((istart <= lastSlotUsed) && (lastSlotUsed < 15)) {
+        istart = lastSlotUsed + 1;
+        if (iend < istart)
+          iend = istart;
+      }
+      lastSlotUsed = iend;
+    }
+
+    fill_gradient_RGB(entries, istart, rgbstart, iend, rgbend);
+    indexstart = indexend;
+    rgbstart = rgbend;
+  }
+}
+
+CRGBPalette256::CRGBPalette256(const CRGBPalette16& rhs16) {
+  for (int i = 0; i < 256; i++) {
+    entries[i] = ColorFromPalette(rhs16, i);
+  }
+}
+
+CRGBPalette256::CRGBPalette256(TProgmemRGBGradientPalette_bytes progpal) {
+  const uint8_t* progent = progpal;
+  CRGB rgbstart(progent[1], progent[2], progent[3]);
+  int indexstart = 0;
+
+  while (indexstart < 255) {
+    progent += 4;
+    int indexend = progent[0];
+    CRGB rgbend(progent[1], progent[2], progent[3]);
+
+    fill_gradient_RGB(entries, indexstart, rgbstart, indexend, rgbend);
+    indexstart = indexend;
+    rgbstart = rgbend;
+  }
+}
+
+CRGB ColorFromPalette(const CRGBPalette16& pal,
+                      uint8_t index,
+                      uint8_t brightness,
+                      TBlendType blendType) {
+  uint8_t hi4 = index >> 4;
+  uint8_t lo4 = index & 0x0F;
+
+  const CRGB* entry = &(pal[0]) + hi4;
+  uint8_t red1 = entry->red;
+  uint8_t green1 = entry->green;
+  uint8_t blue1 = entry->blue;
+
+  if (lo4 && (blendType != NOBLEND)) {
+    entry = (hi4 == 15) ? &(pal[0]) : entry + 1;
+
+    uint8_t f2 = lo4 << 4;
+    uint8_t f1 = 255 - f2;
+
+    red1 = scale8(red1, f1) + scale8(entry->red, f2);
+    green1 = scale8(green1, f1) + scale8(entry->green, f2);
+    blue1 = scale8(blue1, f1) + scale8(entry->blue, f2);
+  }
+
+  if (brightness != 255) {
+    if (brightness) {
+      brightness++;  // adjust for rounding
+      red1 = scale8(red1, brightness);
+      green1 = scale8(green1, brightness);
+      blue1 = scale8(blue1, brightness);
+    } else {
+      red1 = 0;
+      green1 = 0;
+      blue1 = 0;
+    }
+  }
+
+  return CRGB(red1, green1, blue1);
+}
+
+CRGB ColorFromPalette(const CRGBPalette256& pal,
+                      uint8_t index,
+                      uint8_t brightness,
+                      TBlendType) {
+  const CRGB* entry = &(pal[0]) + index;
+
+  uint8_t red = entry->red;
+  uint8_t green = entry->green;
+  uint8_t blue = entry->blue;
+
+  if (brightness != 255) {
+    red = scale8_video(red, brightness);
+    green = scale8_video(green, brightness);
+    blue = scale8_video(blue, brightness);
+  }
+
+  return CRGB(red, green, blue);
+}
+
+// ========================================================================
+// Controller
+// ========================================================================
+void CFastLED::show(uint8_t scale) {
+  m_nShows++;
+  countFPS();
+}
+
+void CFastLED::countFPS(int nFrames) {
+  static int br = 0;
+  static uint32_t lastframe = 0;
+
+  if (br++ >= nFrames) {
+    uint32_t now = GET_MILLIS();
+    now -= lastframe;
+    if (now == 0)
+      now = 1;
+    m_nFPS = (br * 1000) / now;
+    br = 0;
+    lastframe = GET_MILLIS();
+  }
+}
@@ -0,0 +1,607 @@
+/**
+ * Host replacement for the parts of FastLED used by this project.
+ *
+ * Mirrors the FastLED 3.3 API and math (lib8tion, CRGB/CHSV, CPixelView,
+ * palettes, EVERY_N_* timers) closely enough that lib/Effects renders the
+ * same pixels as on the device. Nothing is pushed anywhere on show(); it only
+ * counts frames.
+ */
+#ifndef FASTLED_NATIVE_H
+#define FASTLED_NATIVE_H
+
+#include <Arduino.h>
+#include <stdint.h>
+
+#define FASTLED_NATIVE 1
+#define FASTLED_USING_NAMESPACE
+#define FL_PROGMEM
+
+#ifdef USE_GET_MILLISECOND_TIMER
+uint32_t get_millisecond_timer();
+#define GET_MILLIS get_millisecond_timer
+#else
+#define GET_MILLIS millis
+#endif
+
+// ========================================================================
+// lib8tion
+// ========================================================================
+typedef uint8_t fract8;
+typedef uint16_t fract16;
+typedef uint16_t accum88;
+typedef int16_t saccum87;
+
+inline uint8_t scale8(uint8_t i, fract8 scale) {
+  return (static_cast<uint16_t>(i) * (1 + static_cast<uint16_t>(scale))) >> 8;
+}
+
+inline uint8_t scale8_video(uint8_t i, fract8 scale) {
+  return ((static_cast<int>(i) * static_cast<int>(scale)) >> 8) +
+         ((i && scale) ? 1 : 0);
+}
+
+inline uint16_t scale16(uint16_t i, fract16 scale) {
+  return (static_cast<uint32_t>(i) * (1 + static_cast<uint32_t>(scale))) >>
+         16;
+}
+
+inline uint8_t qadd8(uint8_t i, uint8_t j) {
+  unsigned int t = i + j;
+  return (t > 255) ? 255 : t;
+}
+
+inline uint8_t qsub8(uint8_t i, uint8_t j) {
+  int t = i - j;
+  return (t < 0) ? 0 : t;
+}
+
+inline uint8_t blend8(uint8_t a, uint8_t b, uint8_t amountOfB) {
+  uint16_t partial = (a << 8) | b;
+  partial += (b * amountOfB);
+  partial -= (a * amountOfB);
+  return partial >> 8;
+}
+
+int16_t sin16(uint16_t theta);
+uint8_t sin8(uint8_t theta);
+
+inline uint16_t beat88(accum88 beats_per_minute_88, uint32_t timebase = 0) {
+  return ((GET_MILLIS() - timebase) * beats_per_minute_88 * 280) >> 16;
+}
+
+inline uint16_t beat16(accum88 beats_per_minute, uint32_t timebase = 0) {
+  if (beats_per_minute < 256)
+    beats_per_minute <<= 8;
+  return beat88(beats_per_minute, timebase);
+}
+
+inline uint8_t beat8(accum88 beats_per_minute, uint32_t timebase = 0) {
+  return beat16(beats_per_minute, timebase) >> 8;
+}
+
+inline uint16_t beatsin16(accum88 beats_per_minute,
+                          uint16_t lowest = 0,
+                          uint16_t highest = 65535,
+                          uint32_t timebase = 0,
+                          uint16_t phase_offset = 0) {
+  uint16_t beat = beat16(beats_per_minute, timebase);
+  uint16_t beatsin = (sin16(beat + phase_offset) + 32768);
+  uint16_t rangewidth = highest - lowest;
+  uint16_t scaledbeat = scale16(beatsin, rangewidth);
+  return lowest + scaledbeat;
+}
+
+inline uint8_t beatsin8(accum88 beats_per_minute,
+                        uint8_t lowest = 0,
+                        uint8_t highest = 255,
+                        uint32_t timebase = 0,
+                        uint8_t phase_offset = 0) {
+  uint8_t beat = beat8(beats_per_minute, timebase);
+  uint8_t beatsin = sin8(beat + phase_offset);
+  uint8_t rangewidth = highest - lowest;
+  uint8_t scaledbeat = scale8(beatsin, rangewidth);
+  return lowest + scaledbeat;
+}
+
+extern uint16_t rand16seed;
+
+inline uint8_t random8() {
+  rand16seed = (rand16seed * 2053) + 13849;
+  return static_cast<uint8_t>((rand16seed & 0xFF) + (rand16seed >> 8));
+}
+
+inline uint8_t random8(uint8_t lim) {
+  return (random8() * lim) >> 8;
+}
+
+inline uint8_t random8(uint8_t min, uint8_t lim) {
+  return random8(lim - min) + min;
+}
+
+inline uint16_t random16() {
+  rand16seed = (rand16seed * 2053) + 13849;
+  return rand16seed;
+}
+
+inline uint16_t random16(uint16_t lim) {
+  return (static_cast<uint32_t>(lim) * random16()) >> 16;
+}
+
+inline uint16_t random16(uint16_t min, uint16_t lim) {
+  return random16(lim - min) + min;
+}
+
+inline void random16_set_seed(uint16_t seed) {
+  rand16seed = seed;
+}
+
+inline uint16_t random16_get_seed() {
+  return rand16seed;
+}
+
+// ========================================================================
+// Pixel types
+// ========================================================================
+struct CHSV {
+  union {
+    struct {
+      union {
+        uint8_t hue;
+        uint8_t h;
+      };
+      union {
+        uint8_t saturation;
+        uint8_t sat;
+        uint8_t s;
+      };
+      union {
+        uint8_t value;
+        uint8_t val;
+        uint8_t v;
+      };
+    };
+    uint8_t raw[3];
+  };
+
+  inline CHSV() = default;
+  inline CHSV(uint8_t ih, uint8_t is, uint8_t iv) : h(ih), s(is), v(iv) {}
+};
+
+struct CRGB;
+void hsv2rgb_rainbow(const CHSV& hsv, CRGB& rgb);
+
+struct CRGB {
+  union {
+    struct {
+      union {
+        uint8_t r;
+        uint8_t red;
+      };
+      union {
+        uint8_t g;
+        uint8_t green;
+      };
+      union {
+        uint8_t b;
+        uint8_t blue;
+      };
+    };
+    uint8_t raw[3];
+  };
+
+  typedef enum {
+    Black = 0x000000,
+    Blue = 0x0000FF,
+    Cyan = 0x00FFFF,
+    Gold = 0xFFD700,
+    Green = 0x008000,
+    Magenta = 0xFF00FF,
+    Orange = 0xFFA500,
+    Purple = 0x800080,
+    Red = 0xFF0000,
+    White = 0xFFFFFF,
+    Yellow = 0xFFFF00
+  } HTMLColorCode;
+
+  inline CRGB() = default;
+  inline CRGB(uint8_t ir, uint8_t ig, uint8_t ib) : r(ir), g(ig), b(ib) {}
+  inline CRGB(uint32_t colorcode)
+      : r((colorcode >> 16) & 0xFF),
+        g((colorcode >> 8) & 0xFF),
+        b((colorcode >> 0) & 0xFF) {}
+  inline CRGB(HTMLColorCode colorcode)
+      : CRGB(static_cast<uint32_t>(colorcode)) {}
+  inline CRGB(const CHSV& rhs) { hsv2rgb_rainbow(rhs, *this); }
+
+  inline uint8_t& operator[](uint8_t x) { return raw[x]; }
+  inline const uint8_t& operator[](uint8_t x) const { return raw[x]; }
+
+  inline CRGB& operator=(const CHSV& rhs) {
+    hsv2rgb_rainbow(rhs, *this);
+    return *this;
+  }
+
+  inline CRGB& operator=(const uint32_t colorcode) {
+    r = (colorcode >> 16) & 0xFF;
+    g = (colorcode >> 8) & 0xFF;
+    b = (colorcode >> 0) & 0xFF;
+    return *this;
+  }
+
+  inline CRGB& setRGB(uint8_t nr, uint8_t ng, uint8_t nb) {
+    r = nr;
+    g = ng;
+    b = nb;
+    return *this;
+  }
+
+  inline CRGB& operator+=(const CRGB& rhs) {
+    r = qadd8(r, rhs.r);
+    g = qadd8(g, rhs.g);
+    b = qadd8(b, rhs.b);
+    return *this;
+  }
+
+  inline CRGB& operator-=(const CRGB& rhs) {
+    r = qsub8(r, rhs.r);
+    g = qsub8(g, rhs.g);
+    b = qsub8(b, rhs.b);
+    return *this;
+  }
+
+  inline CRGB& operator|=(const CRGB& rhs) {
+    if (rhs.r > r)
+      r = rhs.r;
+    if (rhs.g > g)
+      g = rhs.g;
+    if (rhs.b > b)
+      b = rhs.b;
+    return *this;
+  }
+
+  inline CRGB& nscale8(uint8_t scaledown) {
+    uint16_t scale_fixed = scaledown + 1;
+    r = (static_cast<uint16_t>(r) * scale_fixed) >> 8;
+    g = (static_cast<uint16_t>(g) * scale_fixed) >> 8;
+    b = (static_cast<uint16_t>(b) * scale_fixed) >> 8;
+    return *this;
+  }
+
+  inline CRGB& fadeToBlackBy(uint8_t fadefactor) {
+    return nscale8(255 - fadefactor);
+  }
+
+  inline uint8_t getAverageLight() const { return (r + g + b) / 3; }
+};
+
+inline bool operator==(const CRGB& lhs, const CRGB& rhs) {
+  return (lhs.r == rhs.r) && (lhs.g == rhs.g) && (lhs.b == rhs.b);
+}
+
+inline bool operator!=(const CRGB& lhs, const CRGB& rhs) {
+  return !(lhs == rhs);
+}
+
+typedef enum {
+  TypicalSMD5050 = 0xFFB0F0,
+  TypicalLEDStrip = 0xFFB0F0,
+  Typical8mmPixel = 0xFFE08C,
+  TypicalPixelString = 0xFFE08C,
+  UncorrectedColor = 0xFFFFFF
+} LEDColorCorrection;
+
+// ========================================================================
+// Pixel sets
+// ========================================================================
+template <class PIXEL_TYPE>
+class CPixelView {
+ public:
+  const int8_t dir;
+  const int len;
+  PIXEL_TYPE* const leds;
+  PIXEL_TYPE* const end_pos;
+
+  template <class T>
+  class pixelset_iterator_base {
+    T* leds;
+    const int8_t dir;
+
+   public:
+    inline pixelset_iterator_base(T* _leds, const int8_t _dir)
+        : leds(_leds), dir(_dir) {}
+    inline pixelset_iterator_base& operator++() {
+      leds += dir;
+      return *this;
+    }
+    inline bool operator==(pixelset_iterator_base& other) const {
+      return leds == other.leds;
+    }
+    inline bool operator!=(pixelset_iterator_base& other) const {
+      return leds != other.leds;
+    }
+    inline PIXEL_TYPE& operator*() const { return *leds; }
+  };
+
+  typedef pixelset_iterator_base<PIXEL_TYPE> iterator;
+  typedef pixelset_iterator_base<const PIXEL_TYPE> const_iterator;
+
+  inline CPixelView(const CPixelView& other)
+      : dir(other.dir),
+        len(other.len),
+        leds(other.leds),
+        end_pos(other.end_pos) {}
+
+  inline CPixelView(PIXEL_TYPE* _leds, int _len)
+      : dir(_len < 0 ? -1 : 1), len(_len), leds(_leds), end_pos(_leds + _len) {}
+
+  inline CPixelView(PIXEL_TYPE* _leds, int _start, int _end)
+      : dir(((_end - _start) < 0) ? -1 : 1),
+        len((_end - _start) + dir),
+        leds(_leds + _start),
+        end_pos(_leds + _start + len) {}
+
+  inline int size() { return abs(len); }
+  inline bool reversed() { return len < 0; }
+
+  inline PIXEL_TYPE& operator[](int x) const {
+    return (dir < 0) ? leds[-x] : leds[x];
+  }
+
+  inline CPixelView operator()(int start, int end) {
+    return CPixelView(leds, start, end);
+  }
+
+  inline CPixelView& operator=(const PIXEL_TYPE& color) {
+    for (iterator pixel = begin(), _end = end(); pixel != _end; ++pixel) {
+      (*pixel) = color;
+    }
+    return *this;
+  }
+
+  inline CPixelView& operator=(const CPixelView& rhs) {
+    for (iterator pixel = begin(), rhspixel = rhs.begin(), _end = end(),
+                  rhs_end = rhs.end();
+         (pixel != _end) && (rhspixel != rhs_end); ++pixel, ++rhspixel) {
+      (*pixel) = (*rhspixel);
+    }
+    return *this;
+  }
+
+  inline CPixelView& nscale8(uint8_t scaledown) {
+    for (iterator pixel = begin(), _end = end(); pixel != _end; ++pixel) {
+      (*pixel).nscale8(scaledown);
+    }
+    return *this;
+  }
+
+  inline CPixelView& fadeToBlackBy(uint8_t fadeBy) {
+    return nscale8(255 - fadeBy);
+  }
+
+  inline CPixelView& fill_solid(const PIXEL_TYPE& color) {
+    *this = color;
+    return *this;
+  }
+
+  inline CPixelView& fill_rainbow(uint8_t initialhue, uint8_t deltahue = 5);
+
+  inline operator PIXEL_TYPE*() const { return leds; }
+
+  inline iterator begin() { return iterator(leds, dir); }
+  inline iterator end() { return iterator(end_pos, dir); }
+  inline iterator begin() const { return iterator(leds, dir); }
+  inline iterator end() const { return iterator(end_pos, dir); }
+};
+
+typedef CPixelView<CRGB> CRGBSet;
+
+template <int SIZE>
+class CRGBArray : public CPixelView<CRGB> {
+  CRGB rawleds[SIZE];
+
+ public:
+  CRGBArray() : CPixelView<CRGB>(rawleds, SIZE) {}
+  using CPixelView::operator=;
+};
+
+// ========================================================================
+// Color utilities and palettes
+// ========================================================================
+typedef enum { NOBLEND = 0, LINEARBLEND = 1 } TBlendType;
+
+typedef uint32_t TProgmemRGBPalette16[16];
+typedef uint8_t TProgmemRGBGradientPalette_byte;
+typedef const TProgmemRGBGradientPalette_byte* TProgmemRGBGradientPalette_bytes;
+typedef TProgmemRGBGradientPalette_bytes TProgmemRGBGradientPalettePtr;
+
+#define DEFINE_GRADIENT_PALETTE(X) \
+  extern const TProgmemRGBGradientPalette_byte X[] FL_PROGMEM =
+#define DECLARE_GRADIENT_PALETTE(X) \
+  extern const TProgmemRGBGradientPalette_byte X[] FL_PROGMEM
+
+extern const TProgmemRGBPalette16 PartyColors_p;
+DECLARE_GRADIENT_PALETTE(Rainbow_gp);
+
+void fill_gradient_RGB(CRGB* leds,
+                       uint16_t startpos,
+                       CRGB startcolor,
+                       uint16_t endpos,
+                       CRGB endcolor);
+
+class CRGBPalette16 {
+ public:
+  CRGB entries[16];
+
+  CRGBPalette16() = default;
+  CRGBPalette16(const TProgmemRGBPalette16& rhs) {
+    for (uint8_t i = 0; i < 16; i++) {
+      entries[i] = rhs[i];
+    }
+  }
+  CRGBPalette16(TProgmemRGBGradientPalette_bytes progpal);
+
+  inline CRGB& operator[](uint8_t x) { return entries[x]; }
+  inline const CRGB& operator[](uint8_t x) const { return entries[x]; }
+};
+
+class CRGBPalette256 {
+ public:
+  CRGB entries[256];
+
+  CRGBPalette256() = default;
+  CRGBPalette256(const CRGBPalette16& rhs16);
+  CRGBPalette256(TProgmemRGBGradientPalette_bytes progpal);
+
+  inline CRGB& operator[](uint8_t x) { return entries[x]; }
+  inline const CRGB& operator[](uint8_t x) const { return entries[x]; }
+};
+
+CRGB ColorFromPalette(const CRGBPalette16& pal,
+                      uint8_t index,
+                      uint8_t brightness = 255,
+                      TBlendType blendType = LINEARBLEND);
+
+CRGB ColorFromPalette(const CRGBPalette256& pal,
+                      uint8_t index,
+                      uint8_t brightness = 255,
+                      TBlendType blendType = NOBLEND);
+
+void fill_solid(CRGB* leds, int numToFill, const CRGB& color);
+void fill_rainbow(CRGB* pFirstLED,
+                  int numToFill,
+                  uint8_t initialhue,
+                  uint8_t deltahue = 5);
+void nscale8(CRGB* leds, uint16_t num_leds, uint8_t scale);
+void fadeToBlackBy(CRGB* leds, uint16_t num_leds, uint8_t fadeBy);
+
+template <typename PALETTE>
+void fill_palette(CRGB* L,
+                  uint16_t N,
+                  uint8_t startIndex,
+                  uint8_t incIndex,
+                  const PALETTE& pal,
+                  uint8_t brightness,
+                  TBlendType blendType) {
+  uint8_t colorIndex = startIndex;
+  for (uint16_t i = 0; i < N; i++) {
+    L[i] = ColorFromPalette(pal, colorIndex, brightness, blendType);
+    colorIndex += incIndex;
+  }
+}
+
+template <class PIXEL_TYPE>
+inline CPixelView<PIXEL_TYPE>& CPixelView<PIXEL_TYPE>::fill_rainbow(
+    uint8_t initialhue,
+    uint8_t deltahue) {
+  if (dir >= 0) {
+    ::fill_rainbow(leds, len, initialhue, deltahue);
+  } else {
+    ::fill_rainbow(leds + len + 1, -len, initialhue, deltahue);
+  }
+  return *this;
+}
+
+// ========================================================================
+// EVERY_N_* timers
+// ========================================================================
+template <uint32_t (*GETTIME)()>
+class CEveryNTime {
+ public:
+  uint32_t mPrevTrigger;
+  uint32_t mPeriod;
+
+  CEveryNTime(uint32_t period) : mPeriod(period) { reset(); }
+
+  inline uint32_t getElapsed() { return GETTIME() - mPrevTrigger; }
+  inline void setPeriod(uint32_t period) { mPeriod = period; }
+  inline void reset() { mPrevTrigger = GETTIME(); }
+
+  inline bool ready() {
+    bool isReady = (getElapsed() >= mPeriod);
+    if (isReady)
+      reset();
+    return isReady;
+  }
+
+  inline operator bool() { return ready(); }
+};
+
+inline uint32_t fastledMillis() {
+  return GET_MILLIS();
+}
+
+inline uint32_t fastledSeconds() {
+  return GET_MILLIS() / 1000;
+}
+
+typedef CEveryNTime<fastledMillis> CEveryNMillis;
+typedef CEveryNTime<fastledSeconds> CEveryNSeconds;
+
+#define CONCAT_HELPER(x, y) x##y
+#define CONCAT_MACRO(x, y) CONCAT_HELPER(x, y)
+
+#define EVERY_N_MILLIS(N) EVERY_N_MILLIS_I(CONCAT_MACRO(PER, __COUNTER__), N)
+#define EVERY_N_MILLIS_I(NAME, N) \
+  static CEveryNMillis NAME(N);   \
+  if (NAME)
+#define EVERY_N_MILLISECONDS(N) EVERY_N_MILLIS(N)
+
+#define EVERY_N_SECONDS(N) EVERY_N_SECONDS_I(CONCAT_MACRO(PER, __COUNTER__), N)
+#define EVERY_N_SECONDS_I(NAME, N) \
+  static CEveryNSeconds NAME(N);   \
+  if (NAME)
+
+// ========================================================================
+// FastLED controller
+// ========================================================================
+
+/** A strip, only keeping which pixels it would send. */
+class CLEDController {
+ public:
+  virtual ~CLEDController() {}
+
+  CLEDController& setLeds(CRGB* data, int nLeds) {
+    m_Data = data;
+    m_nLeds = nLeds;
+    return *this;
+  }
+
+  CRGB* leds() { return m_Data; }
+  int size() { return m_nLeds; }
+
+ private:
+  CRGB* m_Data = nullptr;
+  int m_nLeds = 0;
+};
+
+class CFastLED {
+ public:
+  CLEDController& addLeds(CLEDController* pLed, CRGB* data, int nLeds) {
+    return pLed->setLeds(data, nLeds);
+  }
+
+  void setBrightness(uint8_t scale) { m_Scale = scale; }
+  uint8_t getBrightness() { return m_Scale; }
+
+  void setCorrection(const CRGB& correction) { m_Correction = correction; }
+  void setMaxPowerInVoltsAndMilliamps(uint8_t volts, uint32_t milliamps) {}
+
+  void show() { show(m_Scale); }
+  void show(uint8_t scale);
+
+  void countFPS(int nFrames = 25);
+  uint16_t getFPS() { return m_nFPS; }
+
+  /** Number of times show() has been called since start. */
+  uint32_t getShowCount() { return m_nShows; }
+
+ private:
+  uint8_t m_Scale = 255;
+  CRGB m_Correction = CRGB(UncorrectedColor);
+  uint16_t m_nFPS = 0;
+  uint32_t m_nShows = 0;
+};
+
+extern CFastLED FastLED;
+
+#endif  // FASTLED_NATIVE_H
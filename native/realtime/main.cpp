@@ -0,0 +1,211 @@
+/*
+ * Realtime input on the host.
+ *
+ * "listen" runs the controller loop on the real clock the way src/main.cpp
+ * does on ESP32: effects render until DDP or E1.31 packets arrive, then the
+ * packets drive the output until they stop for REALTIME_TIMEOUT ms. Every
+ * switch is logged, and the shown frames can be captured to a file.
+ *
+ * "send" is a sender to test it with, streaming a moving rainbow at 40 fps.
+ *
+ *   pio run -e native-realtime
+ *   .pio/build/native-realtime/program listen [seconds] [capture.txt]
+ *   .pio/build/native-realtime/program send <ddp|e131> [host] [frames]
+ */
+#include <Arduino.h>
+#include <FastLED.h>
+
+#include <Clock.h>
+#include <Effects.hpp>
+#include <Hdr.h>
+#include <LedOutput.hpp>
+#include <LightState.hpp>
+#include <Realtime.h>
+#include <arpa/inet.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#define CAPTURE_FRAMES 600
+#define SEND_FPS 40
+
+alignas(4) CRGB leds[LED_COUNT];
+#ifdef HDR_OUTPUT
+CRGB frame[LED_COUNT];
+Hdr::Dither dither;
+#else
+CRGB* frame = leds;
+#endif
+Effects::Controller effects;
+LightState::Controller lightState;
+LedOutput::CaptureOutput output(CAPTURE_FRAMES);
+Realtime::Receiver realtime;
+
+int listen(uint32_t seconds, const char* capture) {
+  lightState.initialize();
+  effects.setup(leds, LED_COUNT, lightState.getCurrentState());
+  effects.handleStateChange(lightState.parseNewState(
+      "{\"state\":\"ON\",\"brightness\":255,\"effect\":\"Rainbow\"}"));
+  output.begin(frame, LED_COUNT);
+
+  if (!realtime.begin(leds, LED_COUNT)) {
+    Serial.println("[native] could not open the realtime ports.");
+    return 1;
+  }
+
+  uint32_t realtimeFrames = 0;
+  uint32_t effectFrames = 0;
+  bool active = false;
+  uint32_t start = Clock::millis();
+
+  while (Clock::millis() - start < seconds * 1000) {
+    bool realtimeFrame = realtime.poll();
+    uint8_t brightness = effects.getBrightness16() >> 8;
+
+    if (realtime.isActive() != active) {
+      active = realtime.isActive();
+      Serial.printf("[native] %u ms: %s\n", Clock::millis() - start,
+                    active ? "realtime" : "effects");
+    }
+
+    if (realtime.isActive()) {
+      if (realtimeFrame) {
+#ifdef HDR_OUTPUT
+        memcpy(frame, leds, sizeof(frame));
+        dither.reset();
+#endif
+        output.present(brightness);
+        realtimeFrames++;
+      }
+    } else if (effects.renderFrame()) {
+#ifdef HDR_OUTPUT
+      uint16_t scale;
+      brightness = Hdr::splitBrightness(effects.getBrightness16(), scale);
+      dither.render(effects.getHdrFrame(), frame, LED_COUNT, scale);
+#endif
+      output.present(brightness);
+      effectFrames++;
+    }
+    delayMicroseconds(200);
+  }
+
+  Serial.printf(
+      "[native] realtime frames: %u effect frames: %u packets: %u rejected: "
+      "%u\n",
+      realtimeFrames, effectFrames, realtime.getPackets(),
+      realtime.getRejected());
+
+  if (capture != nullptr && !output.save(capture)) {
+    Serial.printf("[native] could not write %s\n", capture);
+    return 1;
+  }
+  return 0;
+}
+
+/**
+ * Fills packet with a DDP datagram of the leds from first, returns its size.
+ */
+uint16_t ddpPacket(uint8_t* packet, uint16_t first, uint16_t count,
+                   uint8_t sequence, bool push) {
+  uint32_t offset = first * 3;
+  uint16_t length = count * 3;
+
+  packet[0] = 0x40 | (push ? 0x01 : 0);
+  packet[1] = sequence & 0x0f;
+  packet[2] = 0x0b;  // RGB, 8 bit
+  packet[3] = 1;
+  packet[4] = offset >> 24;
+  packet[5] = offset >> 16;
+  packet[6] = offset >> 8;
+  packet[7] = offset;
+  packet[8] = length >> 8;
+  packet[9] = length;
+  memcpy(packet + 10, leds + first, length);
+  return 10 + length;
+}
+
+/**
+ * Fills packet with an E1.31 data packet for one universe, returns its size.
+ */
+uint16_t e131Packet(uint8_t* packet, uint16_t universe, uint16_t first,
+                    uint16_t count, uint8_t sequence) {
+  uint16_t channels = count * 3;
+  uint16_t size = 126 + channels;
+  memset(packet, 0, 126);
+
+  // Root layer
+  packet[1] = 0x10;
+  memcpy(packet + 4, "ASC-E1.17", 9);
+  packet[16] = 0x70 | ((size - 16) >> 8);
+  packet[17] = size - 16;
+  packet[21] = 0x04;
+  // Framing layer
+  packet[38] = 0x70 | ((size - 38) >> 8);
+  packet[39] = size - 38;
+  packet[43] = 0x02;
+  strcpy(reinterpret_cast<char*>(packet + 44), "ledshelf native");
+  packet[108] = 100;
+  packet[111] = sequence;
+  packet[113] = universe >> 8;
+  packet[114] = universe;
+  // DMP layer
+  packet[115] = 0x70 | ((size - 115) >> 8);
+  packet[116] = size - 115;
+  packet[117] = 0x02;
+  packet[118] = 0xa1;
+  packet[122] = 0x01;
+  packet[123] = (channels + 1) >> 8;
+  packet[124] = channels + 1;
+  memcpy(packet + 126, leds + first, channels);
+  return size;
+}
+
+int send(bool ddp, const char* host, uint32_t frames) {
+  static uint8_t packet[REALTIME_PACKET_SIZE];
+
+  int sock = socket(AF_INET, SOCK_DGRAM, 0);
+  struct sockaddr_in destination = {};
+  destination.sin_family = AF_INET;
+  destination.sin_port = htons(ddp ? DDP_PORT : E131_PORT);
+  destination.sin_addr.s_addr = inet_addr(host);
+
+  uint16_t chunk = ddp ? 480 : Realtime::E131_LEDS_PER_UNIVERSE;
+  for (uint32_t f = 0; f < frames; f++) {
+    fill_rainbow(leds, LED_COUNT, f * 4, 255 / LED_COUNT + 1);
+
+    for (uint16_t first = 0; first < LED_COUNT; first += chunk) {
+      uint16_t count = (LED_COUNT - first < chunk) ? LED_COUNT - first : chunk;
+      uint16_t size =
+          ddp ? ddpPacket(packet, first, count, f, first + count >= LED_COUNT)
+              : e131Packet(packet, REALTIME_UNIVERSE + first / chunk, first,
+                           count, f);
+      sendto(sock, packet, size, 0,
+             reinterpret_cast<struct sockaddr*>(&destination),
+             sizeof(destination));
+    }
+    usleep(1000000 / SEND_FPS);
+  }
+
+  close(sock);
+  Serial.printf("[native] sent %u %s frames to %s\n", frames,
+                ddp ? "ddp" : "e1.31", host);
+  return 0;
+}
+
+int main(int argc, char** argv) {
+  if (argc > 2 && strcmp(argv[1], "send") == 0) {
+    return send(strcmp(argv[2], "ddp") == 0,
+                (argc > 3) ? argv[3] : "127.0.0.1",
+                (argc > 4) ? atol(argv[4]) : SEND_FPS * 5);
+  }
+  if (argc > 1 && strcmp(argv[1], "listen") == 0) {
+    return listen((argc > 2) ? atol(argv[2]) : 10,
+                  (argc > 3) ? argv[3] : nullptr);
+  }
+
+  fprintf(stderr,
+          "usage: %s listen [seconds] [capture.txt]\n"
+          "       %s send <ddp|e131> [host] [frames]\n",
+          argv[0], argv[0]);
+  return 2;
+}
@@ -0,0 +1,219 @@
+/*
+ * Host runner for the native build.
+ *
+ * Drives Effects::Controller and LightState::Controller the same way
+ * src/main.cpp does on the device, feeding each effect through the normal
+ * JSON command path and running it for a while against the FastLED shim.
+ *
+ * Time is virtual: every loop advances the clock by LOOP_MICROS, so runs are
+ * reproducible and an hour of animation takes seconds.
+ *
+ * Then Rainbow is put on one shelf at a time over a black strip through the
+ * zones field, and every effect on the last shelf, and the run fails if one
+ * shows anywhere but on its shelf.
+ *
+ * Given a capture file, the last CAPTURE_FRAMES frames sent to the output
+ * are written to it at the end, one line per frame.
+ *
+ *   pio run -e native && .pio/build/native/program [simulated ms per effect]
+ *     [capture.txt]
+ */
+#include <Arduino.h>
+#include <FastLED.h>
+
+#include <Clock.h>
+#include <Effects.hpp>
+#include <Hdr.h>
+#include <Layout.hpp>
+#include <LedOutput.hpp>
+#include <LightState.hpp>
+#include <string>
+
+// No effect writes past LED_COUNT any more. The guard is a regression check:
+// should one do so again, it keeps that from trashing the objects below and
+// lets us report it. Effects in the crossfade, layer and zone buffers are
+// only checked by the native-asan build.
+#define LED_GUARD 128
+
+// Simulated duration of one pass through loop().
+#define LOOP_MICROS 1000
+
+// WS2812B timing: 30 us per led plus the reset pulse.
+#define TRANSFER_MICROS (LED_COUNT * 30 + 50)
+
+#define CAPTURE_FRAMES 600
+
+alignas(4) CRGB leds[LED_COUNT + LED_GUARD];
+#ifdef HDR_OUTPUT
+CRGB frame[LED_COUNT];
+Hdr::Dither dither;
+#else
+CRGB* frame = leds;
+#endif
+Effects::Controller effects;
+LightState::Controller lightState;
+LedOutput::CaptureOutput output(CAPTURE_FRAMES, TRANSFER_MICROS);
+
+const char* effectNames[] = {
+    "Rainbow",  "Glitter Rainbow", "Gradient",        "RainbowByShelf",
+    "BPM",      "Confetti",        "Juggle",          "Sinelon",
+    "VUMeter",  "Frequencies",     "Music Dancer",    "Pride",
+    "Colorloop", "Walking Rainbow"};
+
+uint32_t checksum(const CRGB* pixels, uint16_t count) {
+  uint32_t sum = 2166136261u;
+  for (uint16_t i = 0; i < count; i++) {
+    sum = (sum ^ pixels[i].r) * 16777619u;
+    sum = (sum ^ pixels[i].g) * 16777619u;
+    sum = (sum ^ pixels[i].b) * 16777619u;
+  }
+  return sum;
+}
+
+bool guardTouched() {
+  for (uint16_t i = LED_COUNT; i < LED_COUNT + LED_GUARD; i++) {
+    if (leds[i] != CRGB(CRGB::Black))
+      return true;
+  }
+  return false;
+}
+
+/**
+ * Sends one JSON command and runs the loop for runtime simulated ms.
+ */
+void run(const char* name, const std::string& command, unsigned long runtime) {
+  effects.handleStateChange(lightState.parseNewState(command));
+
+  fill_solid(leds + LED_COUNT, LED_GUARD, CRGB::Black);
+  uint32_t shows = output.getPresentedFrames();
+  uint32_t skipped = output.getSkippedFrames();
+  uint32_t dropped = output.getDroppedFrames();
+  uint32_t loops = 0;
+  unsigned long start = Clock::millis();
+  unsigned long wallStart = millis();
+
+  while (Clock::millis() - start < runtime) {
+    if (effects.renderFrame()) {
+#ifdef HDR_OUTPUT
+      uint16_t scale;
+      uint8_t brightness =
+          Hdr::splitBrightness(effects.getBrightness16(), scale);
+      dither.render(effects.getHdrFrame(), frame, LED_COUNT, scale);
+      output.present(brightness);
+#else
+      output.present(FastLED.getBrightness());
+#endif
+    }
+    loops++;
+    Clock::advanceMicros(LOOP_MICROS);
+  }
+
+  Serial.printf(
+      "[native] %-22s loops: %8u shows: %5u skipped: %5u dropped: %4u "
+      "wall: %5lu ms checksum: %08x%s\n",
+      name, loops, output.getPresentedFrames() - shows,
+      output.getSkippedFrames() - skipped,
+      output.getDroppedFrames() - dropped, millis() - wallStart,
+      checksum(output.getFrame(), LED_COUNT),
+      guardTouched() ? " (wrote past LED_COUNT)" : "");
+}
+
+/**
+ * Runs effect on shelf z, with the rest of the strip off, and returns how
+ * many pixels were lit off that shelf, or dark on it when whole is set.
+ */
+uint16_t runZone(uint8_t z, const char* effect, bool whole,
+                 unsigned long runtime) {
+  std::string zones;
+  for (uint8_t k = 0; k < z; k++) {
+    zones += "\"\",";
+  }
+  std::string name = "Zone " + std::to_string(z) + " " + effect;
+  run(name.c_str(),
+      "{\"state\":\"ON\",\"effect\":\"none\",\"transition\":0,"
+      "\"color\":{\"r\":0,\"g\":0,\"b\":0},\"zones\":[" +
+          zones + "\"" + effect + "\"]}",
+      runtime);
+
+  uint16_t wrong = 0;
+  for (uint16_t i = 0; i < LED_COUNT; i++) {
+    bool lit = leds[i] != CRGB(CRGB::Black);
+    bool on = Layout::shelf(i) == z;
+    if ((lit && !on) || (!lit && on && whole))
+      wrong++;
+  }
+  if (wrong > 0)
+    Serial.printf("[native] zone %i %s: %u leds wrong\n", z, effect, wrong);
+  return wrong;
+}
+
+/**
+ * Runs Rainbow on each shelf in turn and every effect on the last one, and
+ * returns how many pixels were out of place.
+ */
+uint32_t checkZones(unsigned long runtime) {
+  uint32_t misplaced = 0;
+
+  for (uint8_t z = 0; z < Layout::shelfCount(); z++) {
+    misplaced += runZone(z, "Rainbow", true, runtime);
+  }
+  for (const char* name : effectNames) {
+    misplaced += runZone(Layout::shelfCount() - 1, name, false, runtime);
+  }
+
+  // The freed shelves go back to the plain black of the strip.
+  run("Zones cleared",
+      "{\"state\":\"ON\",\"transition\":0,\"zones\":[]}", runtime);
+  for (uint16_t i = 0; i < LED_COUNT; i++) {
+    if (leds[i] != CRGB(CRGB::Black))
+      misplaced++;
+  }
+  return misplaced;
+}
+
+int main(int argc, char** argv) {
+  unsigned long runtime = (argc > 1) ? atol(argv[1]) : 10000;
+
+  Clock::useVirtual();
+  random16_set_seed(1337);
+
+  Serial.printf("[native] Starting version %s with %i leds at %i fps\n",
+                VERSION, LED_COUNT, FPS);
+
+  lightState.initialize();
+  effects.setup(leds, LED_COUNT, lightState.getCurrentState());
+  output.begin(frame, LED_COUNT);
+
+  for (const char* name : effectNames) {
+    run(name,
+        "{\"state\":\"ON\",\"brightness\":255,\"effect\":\"" +
+            std::string(name) + "\"}",
+        runtime);
+  }
+
+  run("Gradient+Confetti",
+      "{\"state\":\"ON\",\"effect\":\"Gradient\",\"layers\":[{\"effect\":"
+      "\"Confetti\",\"blend\":\"add\"},{\"effect\":\"Sinelon\",\"blend\":"
+      "\"max\",\"opacity\":128}]}",
+      runtime);
+  run("Gradient", "{\"state\":\"ON\",\"layers\":[]}", runtime);
+
+  uint32_t misplaced = checkZones(runtime);
+  run("Off", "{\"state\":\"OFF\"}", runtime);
+
+  if (argc > 2) {
+    if (!output.save(argv[2])) {
+      Serial.printf("[native] could not write %s\n", argv[2]);
+      return 1;
+    }
+    Serial.printf("[native] %u frames captured, last %u written to %s\n",
+                  output.getCapturedFrames(), output.getKeptFrames(), argv[2]);
+  }
+
+  if (misplaced > 0) {
+    Serial.printf("[native] zones FAILED, %u leds off their shelf\n",
+                  misplaced);
+    return 1;
+  }
+  return 0;
+}
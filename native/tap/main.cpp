@@ -0,0 +1,126 @@
+/*
+ * Receiver for the frame tap in lib/FrameTap.
+ *
+ * Listens on a UDP port, puts the datagrams of each frame back together and
+ * writes every complete frame to a file in the same format as the native
+ * runner's capture: one line per frame with the controller's time in us, the
+ * brightness and every pixel as rrggbb. Frames missing a datagram are
+ * dropped, and gaps in the sequence numbers are counted as lost.
+ *
+ * Runs until the given number of seconds has passed or Ctrl-C.
+ *
+ *   pio run -e native-tap
+ *   .pio/build/native-tap/program <port> <session.txt> [seconds]
+ */
+#include <Arduino.h>
+#include <FastLED.h>
+
+#include <FrameTap.h>
+#include <arpa/inet.h>
+#include <signal.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+// Every led a header can address.
+CRGB pixels[UINT16_MAX];
+uint8_t datagram[FrameTap::PACKET_SIZE];
+
+volatile bool running = true;
+
+void handleSignal(int) {
+  running = false;
+}
+
+int main(int argc, char** argv) {
+  if (argc < 3) {
+    fprintf(stderr, "usage: %s <port> <session.txt> [seconds]\n", argv[0]);
+    return 2;
+  }
+  uint16_t port = atoi(argv[1]);
+  uint32_t seconds = (argc > 3) ? atol(argv[3]) : 0;
+
+  int sock = socket(AF_INET, SOCK_DGRAM, 0);
+  struct sockaddr_in address = {};
+  address.sin_family = AF_INET;
+  address.sin_port = htons(port);
+  address.sin_addr.s_addr = htonl(INADDR_ANY);
+  if (sock < 0 ||
+      bind(sock, reinterpret_cast<struct sockaddr*>(&address),
+           sizeof(address)) < 0) {
+    fprintf(stderr, "[tap] could not listen on port %u\n", port);
+    return 1;
+  }
+
+  // Wake up every so often to check the time and Ctrl-C.
+  struct timeval timeout = {0, 200000};
+  setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+  signal(SIGINT, handleSignal);
+
+  FILE* out = fopen(argv[2], "w");
+  if (out == nullptr) {
+    fprintf(stderr, "[tap] could not write %s\n", argv[2]);
+    return 1;
+  }
+
+  fprintf(stderr, "[tap] listening on port %u, recording to %s\n", port,
+          argv[2]);
+
+  uint32_t frames = 0;
+  uint32_t lost = 0;
+  uint32_t incomplete = 0;
+  uint32_t sequence = 0;
+  uint32_t received = 0;
+  bool started = false;
+  bool complete = true;
+  time_t start = time(nullptr);
+
+  while (running && (seconds == 0 || time(nullptr) - start < seconds)) {
+    ssize_t size = recv(sock, datagram, sizeof(datagram), 0);
+    if (size < static_cast<ssize_t>(sizeof(FrameTap::Header)))
+      continue;
+
+    FrameTap::Header header;
+    memcpy(&header, datagram, sizeof(header));
+    if (memcmp(header.magic, TAP_MAGIC, sizeof(header.magic)) != 0 ||
+        header.version != TAP_VERSION ||
+        header.offset + header.length > header.count ||
+        size < static_cast<ssize_t>(sizeof(header) +
+                                    header.length * sizeof(CRGB)))
+      continue;
+
+    if (!started || header.sequence != sequence) {
+      if (started && !complete)
+        incomplete++;
+      if (started && header.sequence > sequence + 1)
+        lost += header.sequence - sequence - 1;
+
+      started = true;
+      complete = false;
+      sequence = header.sequence;
+      received = 0;
+    }
+
+    memcpy(pixels + header.offset, datagram + sizeof(header),
+           header.length * sizeof(CRGB));
+    received += header.length;
+    if (complete || received < header.count)
+      continue;
+
+    complete = true;
+    frames++;
+    fprintf(out, "%u %u ", header.micros, header.brightness);
+    for (uint16_t i = 0; i < header.count; i++) {
+      fprintf(out, "%02x%02x%02x", pixels[i].r, pixels[i].g, pixels[i].b);
+    }
+    fputc('\n', out);
+  }
+
+  fclose(out);
+  close(sock);
+
+  fprintf(stderr, "[tap] %u frames recorded, %u lost, %u incomplete\n",
+          frames, lost, incomplete);
+  return 0;
+}
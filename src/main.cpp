@@ -19,12 +19,19 @@
 #include <Arduino.h>
 #include <FastLED.h>
 
+#include <Clock.h>
 #include <Effects.hpp>
+#include <Governor.h>
+#include <Hdr.h>
+#include <LedOutput.hpp>
 #include <LightState.hpp>
+#include <Profiler.h>
 
 #ifdef ESP32
 // Over the air update is only available on esp.
+#include <FrameTap.h>
 #include <LedshelfOTA.hpp>
+#include <Realtime.h>
 #elif TEENSY
 #include <TeensyUtil.hpp>
 #endif
@@ -36,10 +43,38 @@
 FASTLED_USING_NAMESPACE
 
 EventDispatcher eventhub;
-CRGBArray<LED_COUNT> leds;
+// Word aligned for the packed pixel kernels in Pixels.
+alignas(4) CRGBArray<LED_COUNT> leds;
 LedshelfConfig config;
 Effects::Controller effects;
 LightState::Controller lightState;
+Governor::Controller governor;
+
+#ifdef ESP32
+Realtime::Receiver realtime;
+FrameTap::Tap tap;
+#ifndef TAP_PORT
+#define TAP_PORT 7070
+#endif
+#ifndef TAP_DIVIDER
+#define TAP_DIVIDER 4
+#endif
+#endif
+
+#ifdef HDR_OUTPUT
+// Effects render into leds, the dithered 16 bit frame is sent from here.
+CRGB frame[LED_COUNT];
+Hdr::Dither dither;
+#else
+CRGB* frame = leds;
+#endif
+
+#if defined(ESP32) && defined(PIPELINED_OUTPUT)
+// Render on the loop core, push to the strip from the other one.
+LedOutput::PipelinedOutput output;
+#else
+LedOutput::DirectOutput output;
+#endif
 
 uint16_t commandFrames = FPS;
 uint16_t commandFrameCount = 0;
@@ -49,6 +84,30 @@ uint8_t updateProgress = 0;
 // ========================================================================
 // FastLED Setup
 // ========================================================================
+#if defined(LED_DATA_4)
+#define LED_STRIPS 4
+#elif defined(LED_DATA_3)
+#define LED_STRIPS 3
+#elif defined(LED_DATA_2)
+#define LED_STRIPS 2
+#else
+#define LED_STRIPS 1
+#endif
+
+/**
+ * Adds the clockless strip on data pin PIN, showing part index of the frame
+ * split evenly over LED_STRIPS strips.
+ */
+template <uint8_t PIN>
+void addDataStrip(uint8_t index) {
+  uint16_t offset = LED_COUNT * index / LED_STRIPS;
+  uint16_t count = LED_COUNT * (index + 1) / LED_STRIPS - offset;
+
+  output.addStrip(
+      FastLED.addLeds<LED_TYPE, PIN, LED_COLOR_ORDER>(frame + offset, count),
+      offset, count);
+}
+
 void setupFastLED() {
 #ifdef DEBUG
   Serial.println("[main] Setting up LED:");
@@ -60,13 +119,25 @@ void setupFastLED() {
   Serial.printf("[main]   type: SK9822, data: %i, clock: %i.\n", LED_DATA,
                 LED_CLOCK);
 #endif
-  FastLED.addLeds<LED_TYPE, LED_DATA, LED_CLOCK, LED_COLOR_ORDER,
-                  DATA_RATE_MHZ(12)>(leds, LED_COUNT);
+  output.addStrip(FastLED.addLeds<LED_TYPE, LED_DATA, LED_CLOCK,
+                                  LED_COLOR_ORDER, DATA_RATE_MHZ(12)>(
+                      frame, LED_COUNT),
+                  0, LED_COUNT);
 #else
 #ifdef DEBUG
-  Serial.printf("[main]   type: WS2812B, data: %i\n", LED_DATA);
+  Serial.printf("[main]   type: WS2812B, data: %i, strips: %i\n", LED_DATA,
+                LED_STRIPS);
+#endif
+  addDataStrip<LED_DATA>(0);
+#ifdef LED_DATA_2
+  addDataStrip<LED_DATA_2>(1);
+#endif
+#ifdef LED_DATA_3
+  addDataStrip<LED_DATA_3>(2);
+#endif
+#ifdef LED_DATA_4
+  addDataStrip<LED_DATA_4>(3);
 #endif
-  FastLED.addLeds<LED_TYPE, LED_DATA, LED_COLOR_ORDER>(leds, LED_COUNT);
 #endif
 
   FastLED.setCorrection(TypicalSMD5050);
@@ -79,9 +150,64 @@ void setupFastLED() {
   //               currentState.effect.c_str());
   FastLED.countFPS(FPS);
 #endif
+
+  output.begin(frame, LED_COUNT);
 }
 // END OF setupFastLED
 
+/**
+ * Sends the governor's level and load to the information topic.
+ */
+void publishGovernor() {
+  char message[192];
+  governor.describe(message, sizeof(message));
+  eventhub.publishInformation(message);
+}
+
+#ifdef ESP32
+/**
+ * "tap <ip> [port] [divider]" starts streaming frames to ip, "tap off"
+ * stops it. The divider goes from 1 to 255.
+ */
+void handleTapQuery(const std::string& query) {
+  char host[16] = {};
+  unsigned port = TAP_PORT;
+  unsigned divider = TAP_DIVIDER;
+
+  if (query == "tap off") {
+    tap.stop();
+    eventhub.publishInformation("Frame tap stopped.");
+    return;
+  }
+
+  // Out of range numbers would wrap when narrowed for begin().
+  int fields = sscanf(query.c_str(), "tap %15s %u %u", host, &port, &divider);
+  if (fields >= 1 && port >= 1 && port <= 65535 && divider >= 1 &&
+      divider <= 255 && tap.begin(host, port, divider)) {
+    eventhub.publishInformation("Frame tap started.");
+  } else {
+    eventhub.publishInformation("Frame tap: use tap <ip> [port] [divider].");
+  }
+}
+#endif
+
+#ifdef ESP32
+/**
+ * Shows the frame a realtime sender wrote into leds, at the brightness of
+ * the light.
+ */
+void presentRealtime() {
+  uint8_t brightness = effects.getBrightness16() >> 8;
+#ifdef HDR_OUTPUT
+  // Sent as is, without the 16 bit brightness and dithering.
+  memcpy(frame, leds, sizeof(frame));
+  dither.reset();
+#endif
+  output.present(brightness);
+  tap.frame(leds, LED_COUNT, brightness);
+}
+#endif
+
 /* ======================================================================
  * SETUP
  * ======================================================================
@@ -102,12 +228,37 @@ void setup() {
   eventhub.setLightState(lightState);
   eventhub.onStateChange(
       [](LightState::LightState s) { effects.handleStateChange(s); });
+  eventhub.onQuery([](std::string query) {
+    if (query == "profile") {
+      Profiler::snapshot(
+          [](uint8_t slot) {
+            return effects.getEffectName(static_cast<Effects::Effect>(slot));
+          },
+          [](const char* message) { eventhub.publishInformation(message); });
+    } else if (query == "profile reset") {
+      Profiler::reset();
+    } else if (query == "governor") {
+      publishGovernor();
+#ifdef ESP32
+    } else if (query.rfind("tap", 0) == 0) {
+      handleTapQuery(query);
+#endif
+    }
+  });
 
 #ifdef ESP32
   LedshelfOTA::setup(leds);
   // setupArduinoOTA();
   eventhub.onFirmwareUpdate([]() {
     LedshelfOTA::start();
+#ifdef PIPELINED_OUTPUT
+    // Progress is drawn with FastLED.show() straight from the OTA callbacks.
+    output.stop();
+#endif
+#ifdef HDR_OUTPUT
+    // The update screen is drawn straight into leds.
+    output.bind(leds);
+#endif
 
     effects.setCurrentEffect(Effects::Effect::NullEffect);
     effects.setCurrentCommand(Effects::Command::FirmwareUpdate);
@@ -116,10 +267,17 @@ void setup() {
 #endif  // ESP32
 
   lightState.initialize();
+  Profiler::setup();
 
   delay(2000);
 
   setupFastLED();
+#if defined(ESP32) && defined(TAP_HOST)
+  tap.begin(TAP_HOST, TAP_PORT, TAP_DIVIDER);
+#endif
+#ifdef ESP32
+  realtime.begin(leds, LED_COUNT);
+#endif
 
   effects.setup(leds, LED_COUNT, lightState.getCurrentState());
 }
@@ -128,11 +286,14 @@ void setup() {
  * LOOP
  * ======================================================================
  */
-unsigned long timetowait = 1000 / FPS;
-unsigned long previoustime = 0;
-
 void loop() {
+  Profiler::setSlot(effects.getCurrentEffect());
+
+  uint32_t start = Profiler::cycles();
+  uint32_t started = Clock::micros();
   eventhub.loop();
+  Profiler::record(Profiler::Stage::Network, Profiler::cycles() - start);
+  governor.recordNetwork(Clock::micros() - started);
 
 #ifdef TEENSY
   if (eventhub.mqtt.getHeartbeatAge() > 300000) {
@@ -142,10 +303,16 @@ void loop() {
   }
 #endif
 
+#ifdef ESP32
+  bool realtimeFrame = realtime.poll();
+#endif
+
+  started = Clock::micros();
   if (effects.currentCommandType == Effects::Command::FirmwareUpdate) {
 #ifdef ESP32
     LedshelfOTA::handle();
-    if (millis() > (effects.commandStart + 30000)) {
+    if (Clock::millis() >
+        (effects.getCommandStart(Effects::Command::FirmwareUpdate) + 30000)) {
       eventhub.publishInformation("No update started for 180s. Rebooting.");
       delay(1000);
       ESP.restart();
@@ -158,25 +325,55 @@ void loop() {
 #endif  // DEBUG
     effects.setCurrentCommand(Effects::Command::None);
 #endif
-  } else {
-    effects.runCurrentCommand();
-    effects.runCurrentEffect();
+#ifdef ESP32
+  } else if (realtime.isActive()) {
+    // A PC drives the strip, the effects wait until it stops sending.
+    if (realtimeFrame)
+      presentRealtime();
+#endif
+  } else if (effects.renderFrame()) {
+    start = Profiler::cycles();
+#ifdef HDR_OUTPUT
+    uint16_t scale;
+    uint8_t brightness =
+        Hdr::splitBrightness(effects.getBrightness16(), scale);
+    dither.render(effects.getHdrFrame(), frame, LED_COUNT, scale);
+    bool shown = output.present(brightness);
+#else
+    bool shown = output.present(FastLED.getBrightness());
+#endif
+    Profiler::record(Profiler::Stage::Show, Profiler::cycles() - start);
+#ifdef ESP32
+    tap.frame(leds, LED_COUNT, effects.getBrightness16() >> 8);
+#endif
+
+    // The pipelined output shows on the other core, so a strip that takes
+    // longer than the period only shows up as dropped frames.
+    if (governor.recordFrame(Clock::micros() - started, !shown)) {
+      effects.setFrameMicros(governor.getFrameMicros());
+      effects.setQuality(governor.getQuality());
+      publishGovernor();
+    }
   }
 #ifdef DEBUG
   EVERY_N_SECONDS(10) {
 #ifdef ESP32
-    Serial.printf("[main] ||| fps: %i heap: %i, size: %i, cpu: %i\n",
-                  FastLED.getFPS(), ESP.getFreeHeap(), ESP.getHeapSize(),
-                  ESP.getCpuFreqMHz());
+    Serial.printf(
+        "[main] ||| fps: %i shown: %u skipped: %u dropped: %u heap: %i, size: "
+        "%i, cpu: %i\n",
+        FastLED.getFPS(), output.getPresentedFrames(),
+        output.getSkippedFrames(), output.getDroppedFrames(),
+        ESP.getFreeHeap(), ESP.getHeapSize(), ESP.getCpuFreqMHz());
 #endif
 #ifdef TEENSY
-    Serial.printf("[main] ||| fps: %i, uptime: %lus, heartbeat age: %lu\n",
-                  FastLED.getFPS(), (uint32_t)(millis() / 1000),
-                  eventhub.mqtt.getHeartbeatAge());
+    Serial.printf(
+        "[main] ||| fps: %i, shown: %u skipped: %u, uptime: %lus, heartbeat "
+        "age: %lu\n",
+        FastLED.getFPS(), output.getPresentedFrames(),
+        output.getSkippedFrames(), (uint32_t)(millis() / 1000),
+        eventhub.mqtt.getHeartbeatAge());
 
 #endif
   }
 #endif  // DEBUG
-
-  EVERY_N_MILLIS(timetowait) { FastLED.show(); }
 }